@@ -0,0 +1,367 @@
+#include "CompiledGame.h"
+#include "EnvironmentMgr.hpp"
+#include "Serializer.hpp"
+#include "SetupGameSetting.h"
+#include "gameinstance.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cpp-tree-sitter.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+extern "C" {
+  TSLanguage* tree_sitter_socialgaming();
+}
+
+using namespace var;
+
+
+namespace
+{
+    void writeRow(Encoder &encoder, const std::vector<std::string> &row)
+    {
+        encoder.writeUInt(row.size());
+        for(const auto &token : row) { encoder.writeString(token); }
+    }
+
+    // for sizing containers: everything counted takes at least a byte, so a count can't be more than what's left
+    uint64_t readCount(Decoder &decoder)
+    {
+        uint64_t count = decoder.readUInt();
+        if(count > decoder.remaining())
+        { throw BadVariableArgException("Compiled game has a bad count"); }
+        return count;
+    }
+
+    std::vector<std::string> readRow(Decoder &decoder)
+    {
+        std::vector<std::string> row(readCount(decoder));
+        for(auto &token : row) { token = decoder.readString(); }
+        return row;
+    }
+
+    // a chain of siblings: how many, then each node's type, rows and (control flow) children
+    void writeRules(Encoder &encoder, const std::shared_ptr<RuleNode> &first)
+    {
+        uint64_t count = 0;
+        for(auto node = first; node; node = node->getNextNode()) { count++; }
+        encoder.writeUInt(count);
+
+        for(auto node = first; node; node = node->getNextNode())
+        {
+            encoder.writeUInt(node->getType());
+            encoder.writeUInt(node->isControlFlow());
+            encoder.writeUInt(node->getData().size());
+            for(const auto &row : node->getData()) { writeRow(encoder, row); }
+            if(!node->isControlFlow())
+            { continue; }
+
+            encoder.writeUInt(node->getBody().size());
+            for(const auto &child : node->getBody())
+            {
+                writeRow(encoder, child.key);
+                writeRules(encoder, child.child);
+            }
+        }
+    }
+
+    // control flow nested deeper than this is taken as a bad file rather than recursed into
+    constexpr size_t maxRuleDepth = 256;
+
+    std::shared_ptr<RuleNode> readRules(Decoder &decoder, const std::shared_ptr<ControlFlowRuleNode> &parent, size_t depth = 0)
+    {
+        if(depth >= maxRuleDepth)
+        { throw BadVariableArgException("Compiled game's rules are nested too deeply"); }
+        std::shared_ptr<RuleNode> first, prev;
+        for(uint64_t i = readCount(decoder); i > 0; i--)
+        {
+            uint64_t type = decoder.readUInt();
+            if(type > NodeType::REVERSE)
+            { throw BadVariableArgException("Compiled game has a bad rule"); }
+            bool isControlFlow = decoder.readUInt();
+            std::vector<std::vector<std::string>> rows(readCount(decoder));
+            for(auto &row : rows) { row = readRow(decoder); }
+
+            std::shared_ptr<RuleNode> node;
+            if(isControlFlow)
+            {
+                auto ctrlFlow = std::make_shared<ControlFlowRuleNode>(rows, (NodeType) type);
+                for(uint64_t j = readCount(decoder); j > 0; j--)
+                {
+                    auto key = readRow(decoder);
+                    ctrlFlow->setChildren(key, readRules(decoder, ctrlFlow, depth + 1));
+                }
+                node = ctrlFlow;
+            }
+            else
+            { node = std::make_shared<TaskRuleNode>(rows, (NodeType) type); }
+
+            if(parent) { node->setParentNode(parent); }
+            if(prev) { prev->setNextNode(node); }
+            else { first = node; }
+            prev = node;
+        }
+        return first;
+    }
+
+    varMapType readMap(Decoder &decoder)
+    {
+        varType value = decoder.read();
+        if(!std::holds_alternative<varMapType>(value))
+        { throw BadVariableArgException("Compiled game has bad settings"); }
+        return std::get<varMapType>(value);
+    }
+};
+
+
+// ==========================================CompiledGame==========================================
+std::shared_ptr<const CompiledGame> CompiledGame::compile(std::string_view name, std::string_view source)
+{
+    // one parser per thread, so games can be compiled in parallel (see GameLoader) without making one each time
+    thread_local ts::Language language = tree_sitter_socialgaming();
+    thread_local ts::Parser parser{ language };
+    ts::Tree tree = parser.parseString(source);
+    return fromTree(name, source, tree.getRootNode());
+}
+
+std::shared_ptr<const CompiledGame> CompiledGame::fromTree(std::string_view name, std::string_view source,
+    const ts::Node &root, const std::shared_ptr<const CompiledGame> &unchangedRules)
+{
+    MemoryResourceGuard guard(nullptr); // shared by every game, so not from any one game's arena
+    GameSettings gameSettings;
+    gameSettings.parse(root, source);
+    Settings settings{gameSettings.setupSettings, gameSettings.constants, gameSettings.variables,
+        gameSettings.perPlayerVariables, gameSettings.perAudienceVariables};
+
+    if(unchangedRules)
+    {
+        auto game = assemble(name, hash(source), std::move(settings));
+        if(game->globals == unchangedRules->globals) // resolved the same, so they can be shared as they are
+        {
+            game->rules = unchangedRules->rules;
+            game->program = unchangedRules->program;
+            return game;
+        }
+        settings = game->settings;
+    }
+
+    auto rules = parseRules(root.getChildByFieldName("rules"), source)->getRules();
+    if(!rules)
+    { throw BadVariableArgException("Game " + std::string(name) + " has no rules"); }
+    return build(name, hash(source), std::move(rules), std::move(settings));
+}
+
+std::shared_ptr<const CompiledGame> CompiledGame::build(std::string_view name, uint64_t sourceHash,
+    std::shared_ptr<RuleNode> rules, Settings settings)
+{
+    MemoryResourceGuard guard(nullptr);
+    auto game = assemble(name, sourceHash, std::move(settings));
+
+    // slots and expressions are stored in the nodes, the manager is only needed to lay out the scopes
+    env_mgr::EnvironmentManager mgr;
+    mgr.resolve(rules, game->globals);
+    game->rules = std::move(rules);
+    game->program = env_mgr::RuleProgram::lower(game->rules);
+    return game;
+}
+
+std::shared_ptr<CompiledGame> CompiledGame::assemble(std::string_view name, uint64_t sourceHash, Settings settings)
+{
+    std::shared_ptr<CompiledGame> game(new CompiledGame());
+    game->name = name;
+    game->sourceHash = sourceHash;
+    game->settings = std::move(settings);
+
+    for(const auto &[key, value] : game->settings.constants) { game->globals.push_back(key); }
+    for(const auto &[key, value] : game->settings.variables) { game->globals.push_back(key); }
+
+    Encoder encoder;
+    encoder.write(game->settings.constants);
+    encoder.write(game->settings.variables);
+    encoder.write(game->settings.perPlayer);
+    game->initialState = encoder.release();
+    return game;
+}
+
+std::string CompiledGame::serialize() const
+{
+    Encoder encoder;
+    encoder.writeString("SGC");
+    encoder.writeUInt(version);
+    encoder.writeUInt(sourceHash);
+    encoder.writeString(name);
+    encoder.write(settings.setup);
+    encoder.write(settings.constants);
+    encoder.write(settings.variables);
+    encoder.write(settings.perPlayer);
+    encoder.write(settings.perAudience);
+    writeRules(encoder, rules);
+    return encoder.release();
+}
+
+std::shared_ptr<const CompiledGame> CompiledGame::deserialize(std::string_view data)
+{
+    MemoryResourceGuard guard(nullptr);
+    Decoder decoder(data);
+    if(decoder.readString() != "SGC" || decoder.readUInt() != version)
+    { throw BadVariableArgException("Not a compiled game of this version"); }
+
+    uint64_t sourceHash = decoder.readUInt();
+    std::string name = decoder.readString();
+    Settings settings;
+    settings.setup = readMap(decoder);
+    settings.constants = readMap(decoder);
+    settings.variables = readMap(decoder);
+    settings.perPlayer = readMap(decoder);
+    settings.perAudience = readMap(decoder);
+    auto rules = readRules(decoder, nullptr);
+    if(!decoder.atEnd())
+    { throw BadVariableArgException("Compiled game has trailing data"); }
+
+    return build(name, sourceHash, std::move(rules), std::move(settings));
+}
+
+uint64_t CompiledGame::hash(std::string_view source)
+{
+    // FNV-1a
+    uint64_t result = 14695981039346656037ull;
+    for(unsigned char c : source)
+    {
+        result ^= c;
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+void CompiledGame::start(GameInstance &game) const
+{
+    MemoryResourceGuard guard(game.memory.get());
+    Decoder decoder(initialState);
+    varMapType constants = readMap(decoder);
+    varMapType variables = readMap(decoder);
+    varMapType perPlayer = readMap(decoder);
+
+    game.envMgr->setGlobals(globals);
+    for(const auto &[key, value] : constants) { game.envMgr->setVariable(key, value->getRef()); }
+    for(const auto &[key, value] : variables) { game.envMgr->setVariable(key, value->getRef()); }
+
+    std::map<std::string, varType> playerVars;
+    for(const auto &[key, value] : perPlayer) { playerVars.emplace(key.str(), value->getRef()); }
+    game.setPlayerVariables(std::move(playerVars));
+    game.setRules(program);
+}
+
+
+// ==========================================GameRegistry==========================================
+GameRegistry::GameRegistry(std::filesystem::path aCacheDir, Compiler aCompiler):
+    cacheDir(std::move(aCacheDir)), compiler(std::move(aCompiler))
+{ }
+
+std::shared_ptr<const CompiledGame> GameRegistry::load(std::string_view name, std::string_view source)
+{
+    uint64_t sourceHash = CompiledGame::hash(source);
+    {
+        std::lock_guard lock(mutex);
+        auto it = games.find(std::string(name));
+        if(it != games.end() && it->second->getSourceHash() == sourceHash)
+        { return it->second; }
+    }
+
+    // compiling can take a while, so it's done unlocked. two threads loading the same game both compile it
+    // and the first one stored wins
+    std::shared_ptr<const CompiledGame> game;
+    std::filesystem::path path;
+    if(!cacheDir.empty())
+    {
+        path = cachePath(name, sourceHash);
+        game = readCache(path);
+    }
+    if(!game)
+    {
+        game = compiler(name, source);
+        if(!path.empty()) { writeCache(path, *game); }
+    }
+
+    std::lock_guard lock(mutex);
+    auto &stored = games[std::string(name)];
+    if(!stored || stored->getSourceHash() != sourceHash) { stored = game; }
+    return stored;
+}
+
+std::shared_ptr<const CompiledGame> GameRegistry::get(std::string_view name) const
+{
+    std::lock_guard lock(mutex);
+    auto it = games.find(std::string(name));
+    return it == games.end()? nullptr : it->second;
+}
+
+void GameRegistry::store(std::shared_ptr<const CompiledGame> game)
+{
+    if(!cacheDir.empty()) { writeCache(cachePath(game->getName(), game->getSourceHash()), *game); }
+    std::lock_guard lock(mutex);
+    games[game->getName()] = std::move(game);
+}
+
+std::filesystem::path GameRegistry::cachePath(std::string_view name, uint64_t sourceHash) const
+{
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) sourceHash);
+    return cacheDir / (std::string(name) + "." + hex + ".sgc");
+}
+
+std::shared_ptr<const CompiledGame> GameRegistry::readCache(const std::filesystem::path &path) const
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file)
+    { return nullptr; }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    // a stale or broken cache file is just a miss
+    try { return CompiledGame::deserialize(buffer.str()); }
+    catch(const std::exception &) { return nullptr; }
+}
+
+void GameRegistry::writeCache(const std::filesystem::path &path, const CompiledGame &game) const
+{
+    // written next to it and renamed, so a reader never sees half a file. each writer has its own temp file (this
+    // process and others can be writing the same game at once)
+    static std::atomic<uint64_t> writes{0};
+    std::error_code error;
+    std::filesystem::create_directories(cacheDir, error);
+    auto temp = path;
+    temp += "." + std::to_string(::getpid()) + "." + std::to_string(writes++) + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        if(!file)
+        { return; }
+        const std::string data = game.serialize();
+        file.write(data.data(), data.size());
+        file.close();
+        if(!file)
+        {
+            std::filesystem::remove(temp, error);
+            return;
+        }
+    }
+    std::filesystem::rename(temp, path, error);
+    if(error)
+    {
+        std::filesystem::remove(temp, error);
+        return;
+    }
+
+    // older versions of the game are never loaded again (hot reload would otherwise leave one per save)
+    const std::string prefix = game.getName() + ".";
+    for(const auto &entry : std::filesystem::directory_iterator(cacheDir, error))
+    {
+        std::string file = entry.path().filename().string();
+        bool sameGame = file.size() == prefix.size() + 16 + 4 && file.starts_with(prefix) && file.ends_with(".sgc")
+            && std::all_of(file.begin() + prefix.size(), file.end() - 4, [](char c) { return std::isxdigit(c); });
+        if(sameGame && entry.path() != path) { std::filesystem::remove(entry.path(), error); }
+    }
+}
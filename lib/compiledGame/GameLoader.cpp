@@ -0,0 +1,95 @@
+#include "GameLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+
+// ==========================================MappedFile==========================================
+MappedFile::MappedFile(const std::filesystem::path &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+    { throw std::system_error(errno, std::generic_category(), path.string()); }
+
+    struct stat info;
+    if(::fstat(fd, &info) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), path.string());
+    }
+
+    size = info.st_size;
+    if(size > 0) // empty files can't be mapped, they're just an empty view
+    {
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED)
+        {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), path.string());
+        }
+        data = static_cast<const char*>(mapping);
+    }
+    ::close(fd); // the mapping stays valid
+}
+
+MappedFile::~MappedFile()
+{
+    if(data) { ::munmap(const_cast<char*>(data), size); }
+}
+
+
+// ==========================================GameLoader==========================================
+GameLoader::GameLoader(GameRegistry &aRegistry, size_t aThreads):
+    registry(aRegistry), threads(aThreads > 0? aThreads : std::max(1u, std::thread::hardware_concurrency()))
+{ }
+
+std::vector<GameLoader::Result> GameLoader::loadDirectory(const std::filesystem::path &directory) const
+{
+    std::vector<Result> results;
+    for(const auto &entry : std::filesystem::directory_iterator(directory))
+    {
+        if(!entry.is_regular_file())
+        { continue; }
+        Result result;
+        result.name = entry.path().stem().string();
+        result.path = entry.path();
+        results.push_back(std::move(result));
+    }
+    std::sort(results.begin(), results.end(), [](const Result &a, const Result &b) { return a.name < b.name; });
+
+    // workers take the next file until there are none left, so one big game doesn't hold up a whole share
+    std::atomic<size_t> next{0};
+    auto work = [&]()
+    {
+        for(size_t i = next++; i < results.size(); i = next++) { load(results[i]); }
+    };
+    std::vector<std::thread> pool;
+    for(size_t i = 1; i < std::min(threads, results.size()); i++) { pool.emplace_back(work); }
+    work();
+    for(auto &thread : pool) { thread.join(); }
+    return results;
+}
+
+void GameLoader::load(Result &result) const
+{
+    auto start = std::chrono::steady_clock::now();
+    try
+    {
+        result.source = std::make_shared<const MappedFile>(result.path);
+        result.game = registry.load(result.name, result.source->view());
+    }
+    catch(BadVariableArgException &e) { result.error = e.what(); }
+    catch(const std::exception &e) { result.error = e.what(); }
+    catch(const char* e) { result.error = e; } // GameSettings throws these
+    catch(...) { result.error = "unknown error"; }
+    result.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
@@ -0,0 +1,199 @@
+#include "GameWatcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+
+extern "C" {
+  TSLanguage* tree_sitter_socialgaming();
+}
+
+
+namespace
+{
+    TSPoint pointAt(std::string_view text, size_t offset)
+    {
+        size_t lineStart = offset == 0? std::string_view::npos : text.rfind('\n', offset - 1);
+        uint32_t row = std::count(text.begin(), text.begin() + offset, '\n');
+        uint32_t column = lineStart == std::string_view::npos? offset : offset - lineStart - 1;
+        return {row, column};
+    }
+
+    // whether the edit (or a change of structure it caused) reaches into the rules of after
+    bool touchesRules(const TSTree* before, const TSTree* after, const TSInputEdit &edit)
+    {
+        TSNode rules = ts_node_child_by_field_name(ts_tree_root_node(after), "rules", 5);
+        if(ts_node_is_null(rules))
+        { return true; }
+        uint32_t start = ts_node_start_byte(rules);
+        uint32_t end = ts_node_end_byte(rules);
+        if(edit.start_byte <= end && edit.new_end_byte >= start)
+        { return true; }
+
+        uint32_t count = 0;
+        TSRange* ranges = ts_tree_get_changed_ranges(before, after, &count);
+        bool touched = std::any_of(ranges, ranges + count,
+            [&](const TSRange &range) { return range.start_byte < end && range.end_byte > start; });
+        std::free(ranges);
+        return touched;
+    }
+
+    bool readFile(const std::filesystem::path &path, std::string &out)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if(!file)
+        { return false; }
+        out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return !file.bad();
+    }
+
+    template <typename F>
+    std::string attempt(F action)
+    {
+        try { action(); }
+        catch(BadVariableArgException &e) { return e.what(); }
+        catch(const std::exception &e) { return e.what(); }
+        catch(const char* e) { return e; }
+        catch(...) { return "unknown error"; }
+        return "";
+    }
+};
+
+
+GameWatcher::GameWatcher(GameRegistry &aRegistry, std::filesystem::path aDirectory):
+    registry(aRegistry), directory(std::move(aDirectory)), parser(ts_parser_new(), ts_parser_delete)
+{
+    ts_parser_set_language(parser.get(), tree_sitter_socialgaming());
+}
+
+std::vector<GameWatcher::Change> GameWatcher::poll()
+{
+    std::vector<Change> changes;
+    std::set<std::string> present;
+    std::error_code error;
+    for(const auto &entry : std::filesystem::directory_iterator(directory, error))
+    {
+        std::error_code fileError;
+        if(!entry.is_regular_file(fileError) || fileError)
+        { continue; }
+        auto modified = entry.last_write_time(fileError);
+        if(fileError)
+        { continue; }
+        auto size = entry.file_size(fileError);
+        if(fileError)
+        { continue; }
+
+        std::string name = entry.path().stem().string();
+        present.insert(name);
+        auto [it, added] = files.try_emplace(name);
+        Watched &watched = it->second;
+        if(!added && watched.modified == modified && watched.size == size)
+        { continue; }
+        watched.modified = modified;
+        watched.size = size;
+
+        // read, not mapped: an editor may be truncating the file right now, which would fault a mapping
+        std::string source;
+        Change change{name, nullptr, "", false, false};
+        if(!readFile(entry.path(), source))
+        {
+            change.error = "couldn't read " + entry.path().string();
+            changes.push_back(std::move(change));
+            continue;
+        }
+        if(!added && source == watched.source) // saved without changes
+        { continue; }
+
+        if(added) // through the registry, so a cached build spares the parse (the tree waits for the first edit)
+        {
+            change.error = attempt([&]() { change.game = registry.load(name, source); });
+            watched.source = std::move(source);
+            changes.push_back(std::move(change));
+        }
+        else
+        { changes.push_back(reload(name, watched, std::move(source))); }
+    }
+
+    if(error) // couldn't list the directory, so nothing can be said about what was deleted
+    { return changes; }
+    for(auto it = files.begin(); it != files.end();)
+    {
+        if(present.contains(it->first))
+        {
+            ++it;
+            continue;
+        }
+        changes.push_back({it->first, nullptr, "", false, true});
+        it = files.erase(it);
+    }
+    return changes;
+}
+
+GameWatcher::Change GameWatcher::reload(const std::string &name, Watched &watched, std::string source)
+{
+    Change change{name, nullptr, "", false, false};
+    auto previous = registry.get(name);
+    if(previous && previous->getSourceHash() != CompiledGame::hash(watched.source)) // replaced by someone else
+    { previous = nullptr; }
+
+    // loaded through the registry: the tree of what it was loaded from is built now, so even this first edit is
+    // incremental and can keep the rules
+    if(!watched.parsed)
+    { watched.parsed = parse(nullptr, watched.source); }
+
+    std::optional<Parsed> parsed;
+    bool rulesChanged = true;
+    if(watched.parsed)
+    {
+        TSInputEdit edit = diff(watched.source, source);
+        ts_tree_edit(watched.parsed->handle, &edit);
+        parsed = parse(watched.parsed->handle, source);
+        if(parsed) { rulesChanged = touchesRules(watched.parsed->handle, parsed->handle, edit); }
+    }
+    else
+    { parsed = parse(nullptr, source); }
+    watched.parsed = std::move(parsed);
+    watched.source = std::move(source);
+
+    if(!watched.parsed)
+    {
+        change.error = "failed to parse";
+        return change;
+    }
+    change.error = attempt([&]()
+    {
+        ts::Node root = watched.parsed->tree.getRootNode();
+        change.game = CompiledGame::fromTree(name, watched.source, root, rulesChanged? nullptr : previous);
+        change.rulesReused = previous && change.game->getRules() == previous->getRules();
+        registry.store(change.game);
+    });
+    return change;
+}
+
+std::optional<GameWatcher::Parsed> GameWatcher::parse(TSTree* old, std::string_view source)
+{
+    TSTree* tree = ts_parser_parse_string(parser.get(), old, source.data(), source.size());
+    if(!tree)
+    { return std::nullopt; }
+    return Parsed{ts::Tree(tree), tree};
+}
+
+TSInputEdit GameWatcher::diff(std::string_view before, std::string_view after)
+{
+    size_t common = std::min(before.size(), after.size());
+    size_t prefix = 0;
+    while(prefix < common && before[prefix] == after[prefix]) { prefix++; }
+    size_t suffix = 0;
+    while(suffix < common - prefix && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) { suffix++; }
+
+    TSInputEdit edit;
+    edit.start_byte = prefix;
+    edit.old_end_byte = before.size() - suffix;
+    edit.new_end_byte = after.size() - suffix;
+    edit.start_point = pointAt(before, edit.start_byte);
+    edit.old_end_point = pointAt(before, edit.old_end_byte);
+    edit.new_end_point = pointAt(after, edit.new_end_byte);
+    return edit;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "RuleInterpreter.h"
+#include "RuleProgram.hpp"
+#include "Variables.hpp"
+
+class GameInstance;
+
+// everything a game's source compiles to: its rules (resolved and lowered) and its settings. built once per game and
+// shared read only by every GameInstance running it, each instance only keeps its own state (scopes, pc, players)
+class CompiledGame
+{
+    public:
+        struct Settings
+        {
+            var::varMapType setup;
+            var::varMapType constants;
+            var::varMapType variables;
+            var::varMapType perPlayer;
+            var::varMapType perAudience;
+        };
+
+        static constexpr uint8_t version = 1; // bump when the layout of serialize() changes
+
+        // parses source with tree-sitter. throws BadVariableArgException if it has no rules
+        static std::shared_ptr<const CompiledGame> compile(std::string_view name, std::string_view source);
+        // from a tree of source parsed already (see GameWatcher). a game built from an earlier version of source whose
+        // rules the edit didn't touch can be passed as unchangedRules, its rules and program are then shared instead of
+        // being parsed again (unless the constants/variables, so the global slots, changed)
+        static std::shared_ptr<const CompiledGame> fromTree(std::string_view name, std::string_view source,
+            const ts::Node &root, const std::shared_ptr<const CompiledGame> &unchangedRules = nullptr);
+        // rules as parseRules() gave them, they're resolved here and must not be changed after
+        static std::shared_ptr<const CompiledGame> build(std::string_view name, uint64_t sourceHash,
+            std::shared_ptr<RuleNode> rules, Settings settings);
+
+        // binary form for the cache: rules as their rows (not the tree-sitter tree) plus settings, so loading skips
+        // parsing. deserialize throws BadVariableArgException on data from another version
+        std::string serialize() const;
+        static std::shared_ptr<const CompiledGame> deserialize(std::string_view data);
+
+        static uint64_t hash(std::string_view source);
+
+        // sets game up to run this: its globals, constants and variables (copied into game's arena), the
+        // per player variables new players get, and the rules
+        void start(GameInstance &game) const;
+
+        const std::string& getName() const { return name; }
+        uint64_t getSourceHash() const { return sourceHash; }
+        const std::shared_ptr<RuleNode>& getRules() const { return rules; }
+        const std::shared_ptr<const env_mgr::RuleProgram>& getProgram() const { return program; }
+        const Settings& getSettings() const { return settings; }
+        const std::vector<var::Symbol>& getGlobals() const { return globals; }
+    private:
+        CompiledGame() = default;
+        // everything but the rules
+        static std::shared_ptr<CompiledGame> assemble(std::string_view name, uint64_t sourceHash, Settings settings);
+
+        std::string name;
+        uint64_t sourceHash = 0;
+        std::shared_ptr<RuleNode> rules;
+        std::shared_ptr<const env_mgr::RuleProgram> program;
+        Settings settings;
+        std::vector<var::Symbol> globals; // constants then variables, resolved to global slots
+        std::string initialState; // constants, variables and per player variables encoded, start() decodes them
+};
+
+// compiled games by name, compiled once and shared. with a cacheDir, each is also kept there as
+// <name>.<source hash>.sgc, so a restart loads it back instead of parsing (a changed source has a new hash)
+class GameRegistry
+{
+    public:
+        using Compiler = std::function<std::shared_ptr<const CompiledGame>(std::string_view name, std::string_view source)>;
+
+        GameRegistry(std::filesystem::path aCacheDir = {}, Compiler aCompiler = CompiledGame::compile);
+
+        // the compiled game for source, from memory, the cache dir or compiling it (in that order). thread safe
+        std::shared_ptr<const CompiledGame> load(std::string_view name, std::string_view source);
+        // last game loaded under name, nullptr if none
+        std::shared_ptr<const CompiledGame> get(std::string_view name) const;
+        // replaces the game under its name (and caches it), for games compiled elsewhere. games started from the one
+        // it replaces keep running it
+        void store(std::shared_ptr<const CompiledGame> game);
+    private:
+        std::filesystem::path cachePath(std::string_view name, uint64_t sourceHash) const;
+        std::shared_ptr<const CompiledGame> readCache(const std::filesystem::path &path) const;
+        void writeCache(const std::filesystem::path &path, const CompiledGame &game) const;
+
+        std::filesystem::path cacheDir;
+        Compiler compiler;
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, std::shared_ptr<const CompiledGame>> games;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CompiledGame.h"
+
+// a file mapped read only into memory. view() stays valid as long as the MappedFile does, without copying the file
+class MappedFile
+{
+    public:
+        // throws std::system_error if path can't be opened or mapped
+        MappedFile(const std::filesystem::path &path);
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        std::string_view view() const { return {data, size}; }
+    private:
+        const char* data = nullptr;
+        size_t size = 0;
+};
+
+// loads every game in a directory through a GameRegistry, on a pool of threads (each compiles with its own parser)
+class GameLoader
+{
+    public:
+        struct Result
+        {
+            std::string name; // file name without extension
+            std::filesystem::path path;
+            std::shared_ptr<const MappedFile> source; // nullptr if the file couldn't be read
+            std::shared_ptr<const CompiledGame> game; // nullptr if it failed, see error
+            std::string error;
+            std::chrono::microseconds time{0}; // reading and compiling (or loading from the cache)
+        };
+
+        // threads = 0 uses one per core
+        GameLoader(GameRegistry &aRegistry, size_t aThreads = 0);
+
+        // one result per file, sorted by name. a game that fails doesn't stop the others
+        std::vector<Result> loadDirectory(const std::filesystem::path &directory) const;
+    private:
+        void load(Result &result) const;
+
+        GameRegistry &registry;
+        size_t threads;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cpp-tree-sitter.h>
+
+#include "CompiledGame.h"
+
+// reloads the games of a directory into a GameRegistry when their files change, so new games pick up the new
+// definition while running ones keep the CompiledGame they started with.
+// a changed game is re-parsed incrementally (ts_tree_edit on the tree kept from its last parse, or from the source it
+// was loaded from), and its rules are only rebuilt if the edit touched them
+class GameWatcher
+{
+    public:
+        struct Change
+        {
+            std::string name;
+            std::shared_ptr<const CompiledGame> game; // nullptr if it failed, see error
+            std::string error;
+            bool rulesReused = false; // the edit was outside the rules, they're shared with the previous version
+            bool removed = false; // the file was deleted. the registry keeps the game for anyone still running it
+        };
+
+        GameWatcher(GameRegistry &aRegistry, std::filesystem::path aDirectory);
+        GameWatcher(const GameWatcher&) = delete;
+        GameWatcher& operator=(const GameWatcher&) = delete;
+
+        // checks the directory for new, changed and deleted files and reloads the games that changed. cheap when
+        // nothing changed (only file times and sizes are compared), meant to be called regularly from the server's loop
+        std::vector<Change> poll();
+
+        // the single edit that turns before into after (everything between their common prefix and suffix)
+        static TSInputEdit diff(std::string_view before, std::string_view after);
+    private:
+        // ts::Tree owns the tree but doesn't hand out its TSTree, which editing and incremental parsing need
+        struct Parsed
+        {
+            ts::Tree tree;
+            TSTree* handle;
+        };
+
+        struct Watched
+        {
+            std::filesystem::file_time_type modified;
+            uintmax_t size = 0;
+            std::string source;
+            std::optional<Parsed> parsed; // source's tree. games loaded through the registry get it on their first reload
+        };
+
+        // nullopt if tree-sitter gave up. old (edited to match source) is reused where it still fits
+        std::optional<Parsed> parse(TSTree* old, std::string_view source);
+        Change reload(const std::string &name, Watched &watched, std::string source);
+
+        GameRegistry &registry;
+        std::filesystem::path directory;
+        // held like ts::Parser holds its own, whose parseString() can't be given an old tree
+        std::unique_ptr<TSParser, decltype(&ts_parser_delete)> parser;
+        std::map<std::string, Watched> files;
+};
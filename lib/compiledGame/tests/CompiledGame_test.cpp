@@ -0,0 +1,416 @@
+#include "CompiledGame.h"
+#include "EnvironmentMgr.hpp"
+#include "GameLoader.h"
+#include "GameWatcher.h"
+#include "Serializer.hpp"
+#include "gameinstance.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+
+using namespace var;
+using namespace env_mgr;
+
+
+namespace
+{
+    // stands in for tree-sitter: builds the same small game for any source and counts how often it's asked to
+    struct FakeCompiler
+    {
+        std::shared_ptr<std::atomic<int>> calls = std::make_shared<std::atomic<int>>(0);
+
+        std::shared_ptr<const CompiledGame> operator()(std::string_view name, std::string_view source) const
+        {
+            (*calls)++;
+            using rows = std::vector<std::vector<std::string>>;
+            auto loop = std::make_shared<ControlFlowRuleNode>(rows{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+            auto message = std::make_shared<TaskRuleNode>(rows{{"round"}}, NodeType::MESSAGE);
+            auto after = std::make_shared<TaskRuleNode>(rows{{"winner"}}, NodeType::SCORES);
+            loop->setChildren({"true"}, message);
+            message->setParentNode(loop);
+            loop->setNextNode(after);
+
+            CompiledGame::Settings settings;
+            settings.constants[Symbol("rounds")] = makeVarPtr(1, 2, 3);
+            settings.variables[Symbol("winner")] = allocateVar({}, std::string("nobody"));
+            settings.perPlayer[Symbol("wins")] = allocateVar({}, 0);
+            return CompiledGame::build(name, CompiledGame::hash(source), loop, std::move(settings));
+        }
+    };
+
+    // a copy of games/rockpaper.json in a directory of its own, for tests that parse a real game with tree-sitter
+    std::filesystem::path realGameDir(const std::string &test)
+    {
+        auto dir = std::filesystem::temp_directory_path() / test;
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        std::filesystem::copy_file("games/rockpaper.json", dir / "rockpaper.json");
+        return dir;
+    }
+
+    void replaceIn(const std::filesystem::path &file, const std::string &from, const std::string &to)
+    {
+        std::ifstream in(file);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string source = buffer.str();
+        ASSERT_NE(std::string::npos, source.find(from));
+        source.replace(source.find(from), from.size(), to);
+        std::ofstream(file, std::ios::trunc) << source;
+    }
+};
+
+TEST(CompiledGameTest, registryTest)
+{
+    // init
+    auto cacheDir = std::filesystem::temp_directory_path() / "compiledGameTest";
+    std::filesystem::remove_all(cacheDir);
+    FakeCompiler compiler;
+    GameRegistry registry(cacheDir, compiler);
+
+    // asserts
+    // compiled once, shared after that
+    auto game = registry.load("rps", "source");
+    ASSERT_EQ(game, registry.load("rps", "source"));
+    ASSERT_EQ(game, registry.get("rps"));
+    ASSERT_EQ(nullptr, registry.get("other"));
+    ASSERT_EQ(1, compiler.calls->load());
+
+    // a new registry (restart) loads it from the cache dir without compiling
+    GameRegistry restarted(cacheDir, compiler);
+    auto cached = restarted.load("rps", "source");
+    ASSERT_EQ(1, compiler.calls->load());
+    ASSERT_NE(game, cached);
+    ASSERT_EQ(game->getSourceHash(), cached->getSourceHash());
+    ASSERT_EQ(game->getGlobals(), cached->getGlobals());
+    ASSERT_EQ(game->getProgram()->size(), cached->getProgram()->size());
+    ASSERT_EQ(game->getRules()->getData(), cached->getRules()->getData());
+    ASSERT_EQ(NodeType::MESSAGE, cached->getRules()->getBody()[0].child->getType());
+    ASSERT_EQ(cached->getRules(), cached->getRules()->getBody()[0].child->getParentNode().lock());
+    const listObj &rounds = std::get<listObj>(cached->getSettings().constants.at(Symbol("rounds"))->getRef()); // not compacted
+    ASSERT_EQ(3, rounds.size());
+    ASSERT_TRUE(rounds[2]->isEqual(3));
+
+    // a changed source is compiled again
+    restarted.load("rps", "new source");
+    ASSERT_EQ(2, compiler.calls->load());
+
+    // a bad cache file is ignored, even one with counts too big to allocate
+    Encoder bad;
+    bad.writeString("SGC");
+    bad.writeUInt(CompiledGame::version);
+    bad.writeUInt(CompiledGame::hash("other source"));
+    bad.writeString("rps");
+    for(int i = 0; i < 5; i++) { bad.write(varMapType()); }
+    bad.writeUInt(1); // one rule
+    bad.writeUInt(NodeType::MESSAGE);
+    bad.writeUInt(false);
+    bad.writeUInt(1ull << 62); // rows
+    ASSERT_THROW(CompiledGame::deserialize(bad.data()), BadVariableArgException);
+    ASSERT_THROW(CompiledGame::deserialize("garbage"), BadVariableArgException);
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) CompiledGame::hash("other source"));
+    std::ofstream(cacheDir / ("rps." + std::string(hex) + ".sgc"), std::ios::binary) << bad.data();
+    ASSERT_NE(nullptr, GameRegistry(cacheDir, compiler).load("rps", "other source"));
+    ASSERT_EQ(3, compiler.calls->load());
+
+    // only the newest version of a game stays cached
+    ASSERT_EQ(1, std::distance(std::filesystem::directory_iterator(cacheDir), std::filesystem::directory_iterator()));
+    ASSERT_TRUE(std::filesystem::exists(cacheDir / ("rps." + std::string(hex) + ".sgc")));
+
+    // so is one with rules nested deep enough to run out the stack
+    Encoder deep;
+    deep.writeString("SGC");
+    deep.writeUInt(CompiledGame::version);
+    deep.writeUInt(CompiledGame::hash("deep source"));
+    deep.writeString("rps");
+    for(int i = 0; i < 5; i++) { deep.write(varMapType()); }
+    for(int i = 0; i < 100000; i++)
+    {
+        deep.writeUInt(1); // one rule
+        deep.writeUInt(NodeType::FOR);
+        deep.writeUInt(true);
+        deep.writeUInt(0); // rows
+        deep.writeUInt(1); // one child
+        deep.writeUInt(0); // key
+    }
+    deep.writeUInt(0);
+    ASSERT_THROW(CompiledGame::deserialize(deep.data()), BadVariableArgException);
+    char deepHex[17];
+    std::snprintf(deepHex, sizeof(deepHex), "%016llx", (unsigned long long) CompiledGame::hash("deep source"));
+    std::ofstream(cacheDir / ("rps." + std::string(deepHex) + ".sgc"), std::ios::binary) << deep.data();
+    ASSERT_NE(nullptr, GameRegistry(cacheDir, compiler).load("rps", "deep source"));
+    ASSERT_EQ(4, compiler.calls->load());
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+// writers of the same game each use their own temp file, so the cached file is always one whole write
+TEST(CompiledGameTest, concurrentCacheTest)
+{
+    // init
+    auto cacheDir = std::filesystem::temp_directory_path() / "concurrentCacheTest";
+    std::filesystem::remove_all(cacheDir);
+    FakeCompiler compiler;
+    GameRegistry registry(cacheDir, compiler);
+    auto game = compiler("rps", "source");
+    std::vector<std::thread> writers;
+    for(int i = 0; i < 8; i++)
+    {
+        writers.emplace_back([&]() { for(int j = 0; j < 20; j++) { registry.store(game); } });
+    }
+    for(auto &writer : writers) { writer.join(); }
+
+    // asserts
+    std::vector<std::filesystem::path> files;
+    for(const auto &entry : std::filesystem::directory_iterator(cacheDir)) { files.push_back(entry.path()); }
+    ASSERT_EQ(1, files.size()); // no temp files left behind
+    ASSERT_NE(nullptr, GameRegistry(cacheDir, compiler).load("rps", "source"));
+    ASSERT_EQ(1, compiler.calls->load());
+
+    std::filesystem::remove_all(cacheDir);
+}
+
+TEST(CompiledGameTest, startTest)
+{
+    // init
+    FakeCompiler compiler;
+    auto game = compiler("rps", "source");
+    GameInstance first("rps", 1);
+    GameInstance second("rps", 2);
+    game->start(first);
+    game->start(second);
+
+    // asserts
+    // both run the same rules, each with its own variables
+    ASSERT_EQ(game->getRules()->getBody()[0].child, first.nextTaskRule());
+    ASSERT_EQ(varType(1), first.envMgr->getVariable("round")->getRef());
+    first.envMgr->getVariable("winner")->set(std::string("player1"));
+    ASSERT_EQ(varType(std::string("nobody")), second.envMgr->getVariable("winner")->getRef());
+    ASSERT_EQ(varType(std::string("nobody")), game->getSettings().variables.at(Symbol("winner"))->getRef());
+
+    first.addPlayerToGame(1, "player1");
+    const varType &players = first.envMgr->getVariable("player")->getRef();
+    const varType &player = std::get<listObj>(players)[0]->getRef();
+    ASSERT_EQ(varType(0), std::get<varMapType>(player).at(Symbol("wins"))->getRef());
+}
+
+TEST(CompiledGameTest, loaderTest)
+{
+    // init
+    auto gameDir = std::filesystem::temp_directory_path() / "gameLoaderTest";
+    std::filesystem::remove_all(gameDir);
+    std::filesystem::create_directories(gameDir);
+    std::vector<std::string> names;
+    for(int i = 0; i < 20; i++)
+    {
+        names.push_back("game" + std::to_string(10 + i));
+        std::ofstream(gameDir / (names.back() + ".game")) << "source of " << names.back();
+    }
+    std::ofstream(gameDir / "broken.game") << "broken";
+    std::ofstream(gameDir / "empty.game");
+    names.insert(names.begin(), {"broken", "empty"});
+
+    FakeCompiler fake;
+    GameRegistry registry({}, [&fake](std::string_view name, std::string_view source)
+    {
+        if(source == "broken") { throw BadVariableArgException("bad game"); }
+        return fake(name, source);
+    });
+    auto results = GameLoader(registry, 4).loadDirectory(gameDir);
+
+    // asserts
+    ASSERT_EQ(names.size(), results.size());
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        ASSERT_EQ(names[i], results[i].name);
+        ASSERT_EQ(gameDir / (names[i] + ".game"), results[i].path);
+        if(names[i] == "broken")
+        {
+            ASSERT_EQ(nullptr, results[i].game);
+            ASSERT_EQ("bad game", results[i].error);
+            continue;
+        }
+        ASSERT_NE(nullptr, results[i].game);
+        ASSERT_TRUE(results[i].error.empty());
+        ASSERT_EQ(names[i], results[i].game->getName());
+        ASSERT_EQ(CompiledGame::hash(results[i].source->view()), results[i].game->getSourceHash());
+        ASSERT_EQ(results[i].game, registry.get(names[i]));
+        ASSERT_EQ(names[i] == "empty"? "" : "source of " + names[i], results[i].source->view());
+    }
+    ASSERT_EQ(21, fake.calls->load());
+    ASSERT_THROW(MappedFile(gameDir / "missing.game"), std::system_error);
+
+    std::filesystem::remove_all(gameDir);
+}
+
+// copies of a real game compiled on several threads at once (each with its own parser) all come out the same
+TEST(CompiledGameTest, realParallelLoadTest)
+{
+    // init
+    auto gameDir = realGameDir("realParallelLoadTest");
+    for(int i = 0; i < 7; i++)
+    { std::filesystem::copy_file(gameDir / "rockpaper.json", gameDir / ("rockpaper" + std::to_string(i) + ".json")); }
+    GameRegistry registry;
+    auto results = GameLoader(registry, 4).loadDirectory(gameDir);
+
+    // asserts
+    ASSERT_EQ(8, results.size());
+    auto first = results[0].game;
+    ASSERT_NE(nullptr, first) << results[0].error;
+    for(const auto &result : results)
+    {
+        ASSERT_NE(nullptr, result.game) << result.name << ": " << result.error;
+        ASSERT_EQ(result.name, result.game->getName());
+        ASSERT_EQ(first->getSourceHash(), result.game->getSourceHash());
+        ASSERT_EQ(first->getGlobals(), result.game->getGlobals());
+        ASSERT_EQ(first->getProgram()->size(), result.game->getProgram()->size());
+        ASSERT_EQ(first->getRules()->getData(), result.game->getRules()->getData());
+        if(result.game != first) { ASSERT_NE(first->getRules(), result.game->getRules()); } // compiled separately
+    }
+
+    std::filesystem::remove_all(gameDir);
+}
+
+TEST(CompiledGameTest, watcherTest)
+{
+    // init
+    auto gameDir = std::filesystem::temp_directory_path() / "gameWatcherTest";
+    std::filesystem::remove_all(gameDir);
+    std::filesystem::create_directories(gameDir);
+    std::ofstream(gameDir / "rps.game") << "rps source";
+    std::ofstream(gameDir / "poker.game") << "poker source";
+    FakeCompiler compiler;
+    GameRegistry registry({}, compiler);
+    GameWatcher watcher(registry, gameDir);
+
+    // asserts
+    // new files are loaded through the registry, untouched ones aren't looked at again
+    auto changes = watcher.poll();
+    ASSERT_EQ(2, changes.size());
+    ASSERT_NE(nullptr, registry.get("rps"));
+    ASSERT_TRUE(watcher.poll().empty());
+    std::ofstream(gameDir / "rps.game") << "rps source";
+    ASSERT_TRUE(watcher.poll().empty());
+    std::ofstream(gameDir / "trivia.game") << "trivia source";
+    changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_EQ("trivia", changes[0].name);
+    ASSERT_EQ(3, compiler.calls->load());
+
+    // a changed file is parsed again. if it doesn't compile, the last good version stays
+    auto rps = registry.get("rps");
+    std::ofstream(gameDir / "rps.game") << "rps source, broken";
+    changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_EQ(nullptr, changes[0].game);
+    ASSERT_FALSE(changes[0].error.empty());
+    ASSERT_EQ(rps, registry.get("rps"));
+
+    // a deleted file is forgotten, the registry keeps its last version
+    std::filesystem::remove(gameDir / "poker.game");
+    changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_EQ("poker", changes[0].name);
+    ASSERT_TRUE(changes[0].removed);
+    ASSERT_NE(nullptr, registry.get("poker"));
+    ASSERT_TRUE(watcher.poll().empty());
+    std::ofstream(gameDir / "poker.game") << "poker source";
+    changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_FALSE(changes[0].removed);
+
+    std::filesystem::remove_all(gameDir);
+}
+
+// an edit outside the rules re-parses incrementally and keeps the rules (and program) of the version before, the
+// first edit after the game was loaded too
+TEST(CompiledGameTest, realReloadOutsideRulesTest)
+{
+    // init
+    auto gameDir = realGameDir("reloadOutsideRulesTest");
+    auto file = gameDir / "rockpaper.json";
+    GameRegistry registry;
+    GameWatcher watcher(registry, gameDir);
+    ASSERT_EQ(1, watcher.poll().size());
+    auto loaded = registry.get("rockpaper");
+    ASSERT_NE(nullptr, loaded);
+
+    // asserts
+    replaceIn(file, "\"Rock, Paper, Scissors\"", "\"Rock, Paper, Scissors!\"");
+    auto changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_NE(nullptr, changes[0].game) << changes[0].error;
+    ASSERT_TRUE(changes[0].rulesReused);
+    ASSERT_EQ(loaded->getRules(), changes[0].game->getRules());
+    auto before = changes[0].game;
+
+    replaceIn(file, "\"Rock, Paper, Scissors!\"", "\"Rock, Paper, Scissors!!\"");
+    changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_NE(nullptr, changes[0].game) << changes[0].error;
+    ASSERT_TRUE(changes[0].rulesReused);
+    ASSERT_NE(before, changes[0].game);
+    ASSERT_EQ(before->getRules(), changes[0].game->getRules());
+    ASSERT_EQ(before->getProgram(), changes[0].game->getProgram());
+    ASSERT_EQ(changes[0].game, registry.get("rockpaper"));
+
+    std::filesystem::remove_all(gameDir);
+}
+
+// an edit inside the rules rebuilds them, games started from the version before keep theirs
+TEST(CompiledGameTest, realReloadInsideRulesTest)
+{
+    // init
+    auto gameDir = realGameDir("reloadInsideRulesTest");
+    auto file = gameDir / "rockpaper.json";
+    GameRegistry registry;
+    GameWatcher watcher(registry, gameDir);
+    ASSERT_EQ(1, watcher.poll().size());
+    auto before = registry.get("rockpaper");
+    ASSERT_NE(nullptr, before);
+    auto beforeRules = before->getRules();
+    size_t beforeSize = before->getProgram()->size();
+
+    // asserts
+    replaceIn(file, "Tie game!", "Tie game, again!");
+    auto changes = watcher.poll();
+    ASSERT_EQ(1, changes.size());
+    ASSERT_NE(nullptr, changes[0].game) << changes[0].error;
+    ASSERT_FALSE(changes[0].rulesReused);
+    ASSERT_NE(before->getRules(), changes[0].game->getRules());
+    ASSERT_NE(before->getProgram(), changes[0].game->getProgram());
+    ASSERT_EQ(beforeSize, changes[0].game->getProgram()->size()); // same shape, other text
+    ASSERT_EQ(beforeRules, before->getRules());
+    ASSERT_EQ(changes[0].game, registry.get("rockpaper"));
+
+    std::filesystem::remove_all(gameDir);
+}
+
+TEST(CompiledGameTest, diffTest)
+{
+    TSInputEdit edit = GameWatcher::diff("abc\ndef", "abc\nxyzdef");
+    ASSERT_EQ(4, edit.start_byte);
+    ASSERT_EQ(4, edit.old_end_byte);
+    ASSERT_EQ(7, edit.new_end_byte);
+    ASSERT_EQ(1, edit.start_point.row);
+    ASSERT_EQ(0, edit.start_point.column);
+    ASSERT_EQ(1, edit.new_end_point.row);
+    ASSERT_EQ(3, edit.new_end_point.column);
+
+    edit = GameWatcher::diff("one\ntwo", "one\n");
+    ASSERT_EQ(4, edit.start_byte);
+    ASSERT_EQ(7, edit.old_end_byte);
+    ASSERT_EQ(4, edit.new_end_byte);
+    ASSERT_EQ(3, edit.old_end_point.column);
+
+    edit = GameWatcher::diff("same", "same");
+    ASSERT_EQ(edit.old_end_byte, edit.new_end_byte);
+    ASSERT_EQ(4, edit.start_byte);
+}
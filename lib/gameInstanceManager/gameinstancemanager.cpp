@@ -1,21 +1,26 @@
 #include "include/gameinstancemanager.h"
 
 #include<map>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 
 void GameInstanceManager::createGameInstance(const std::string_view& name, const int& gameInstanceId){
     std::shared_ptr<GameInstance> newGame = std::make_shared<GameInstance>(name, gameInstanceId);
+    newGame->envMgr->setTimerWheel(timerWheel, gameInstanceId);
     putGameInstanceInMap(newGame);
 }
 
 std::shared_ptr<GameInstance> GameInstanceManager::getGameInstanceFromQueue() {
 
+    updateTimers();
+
     std::shared_ptr<GameInstance> game;
 
     if (!activeGameQueue.empty()) {
         game = activeGameQueue.front();
         activeGameQueue.pop();
+        queuedGameIds.erase(game->getGameInstanceId());
     } else {
         std::cout << "GameQueue has no active games!" << std::endl;
         // this will crash if we try to access members after this returns null
@@ -26,6 +31,9 @@ std::shared_ptr<GameInstance> GameInstanceManager::getGameInstanceFromQueue() {
 }
 
 void GameInstanceManager::putGameInstanceInQueue(std::shared_ptr<GameInstance> game) {
+    if (!queuedGameIds.insert(game->getGameInstanceId()).second) {
+        return;
+    }
     activeGameQueue.push(game);
 }
 
@@ -75,3 +83,29 @@ void GameInstanceManager::deletePlayerFromGame(const int& gameInstanceId, const
         std::cout << "Game instance not found" << std::endl;
     }
 }
+
+size_t GameInstanceManager::updateTimers(){
+    // group by game, keeping the order the timers fired in. slots maps a game to its entry so a tick that
+    // fires timers in many games stays linear
+    std::vector<std::pair<int, std::vector<int>>> firedByGame;
+    std::unordered_map<int, size_t> slots;
+    for (const auto& fired : timerWheel->advance()) {
+        auto [slot, added] = slots.try_emplace(fired.owner, firedByGame.size());
+        if (added) {
+            firedByGame.push_back({fired.owner, {}});
+        }
+        firedByGame[slot->second].second.push_back(fired.timer);
+    }
+
+    size_t woken = 0;
+    for (const auto& [gameInstanceId, timerIds] : firedByGame) {
+        auto it = waitingGameMap.find(gameInstanceId);
+        if (it == waitingGameMap.end()) {
+            continue; // game is gone
+        }
+        it->second->timersFired(timerIds);
+        putGameInstanceInQueue(it->second);
+        woken++;
+    }
+    return woken;
+}
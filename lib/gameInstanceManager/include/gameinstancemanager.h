@@ -1,28 +1,38 @@
 #pragma once
 
 #include "gameinstance.h"
+#include "TimerWheel.hpp"
 #include <string_view>
 #include <queue>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 
 class GameInstanceManager {
 
 private:
     std::queue<std::shared_ptr<GameInstance>> activeGameQueue;
+    std::unordered_set<int> queuedGameIds; // games in activeGameQueue, so none is queued (and run) twice
     std::unordered_map<int, std::shared_ptr<GameInstance>> waitingGameMap;
+    // every game's timers, so checking them costs the same for one game or thousands
+    std::shared_ptr<env_mgr::TimerWheel> timerWheel = std::make_shared<env_mgr::TimerWheel>();
 
 public:
     GameInstanceManager() = default;
 
     void createGameInstance(const std::string_view& name, const int& gameInstanceId);
 
+    // fires the timers that are due first (see updateTimers), so the loop taking games off the queue wakes timed games
     std::shared_ptr<GameInstance> getGameInstanceFromQueue();
-    void putGameInstanceInQueue(std::shared_ptr<GameInstance> game);
+    void putGameInstanceInQueue(std::shared_ptr<GameInstance> game); // no-op if game is queued already
 
     std::shared_ptr<GameInstance> getGameInstanceFromMap(const int& gameInstanceId);
     void putGameInstanceInMap(std::shared_ptr<GameInstance> game);
 
     void assignPlayerToGame(const int& gameInstanceId, const std::string_view& playerName, const int& playerId);
     void deletePlayerFromGame(const int& gameInstanceId, const int& playerId); // ignore for now, implement if time
+
+    // fires every timer that is due and queues the games they belong to, once each and only if they aren't queued
+    // already. returns how many games had timers fire
+    size_t updateTimers();
 };
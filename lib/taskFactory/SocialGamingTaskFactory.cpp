@@ -18,11 +18,24 @@ template<class... Ts> overload(Ts...) -> overload<Ts...>;
 
 
 // helper functions
+// elements of any list kind as a listObj. a listObj is shared, typed lists and decks are expanded into a copy
+listObj toListObj(varType list)
+{
+    ListObjUtils::expand(list);
+    return std::get<listObj>(list);
+}
+
+// the elements of list that are T, in order. a typed list of T is copied directly
 template <typename T>
-std::vector<T> copyVec(const listObj &vec)
+std::vector<T> copyVec(const varType &list)
 {
+    if(auto typed = std::get_if<CowList<T, GameAllocator<T>>>(&list))
+    { return {typed->begin(), typed->end()}; }
+    if(!std::holds_alternative<listObj>(list))
+    { return copyVec<T>(toListObj(list)); }
+
     namespace views = std::ranges::views;
-    auto view = vec
+    auto view = std::get<listObj>(list)
                 | views::transform([](const auto &item) { return std::get_if<T>(item->getBorrowPtr()); })
                 | views::filter([](const auto &item) { return item != nullptr; })
                 | views::transform([](const auto &item) { return *(item); });
@@ -83,7 +96,7 @@ bool checkPreconditions(Min sizeMin, Max sizeMax, std::string_view sizeErrorMsg,
 // ===========================================tasks===========================================
 // ========================================reverse definitions========================================
 ReverseTask::ReverseTask(Variable &listToReverse):
-    list(listToReverse.getBorrowPtr())
+    list(&listToReverse)
 { }
 void ReverseTask::run()
 {
@@ -97,23 +110,39 @@ void ReverseTask::run()
 }
 
 // ========================================shuffle definitions========================================
-ShuffleTask::ShuffleTask(Variable &listToShuffle):
-    list(listToShuffle.getBorrowPtr())
+ShuffleTask::ShuffleTask(Variable &listToShuffle, const randomPtr &aRng):
+    list(&listToShuffle),
+    rng(aRng)
 { }
 void ShuffleTask::run()
 {
-    if(list == nullptr)
+    if(list == nullptr || rng == nullptr)
     {
-        debugPrint("list is null, cannot shuffle");
+        debugPrint("list or random generator is null, cannot shuffle");
         return;
     }
-    ListObjUtils::shuffle(*list);
+    ListObjUtils::shuffle(*list, *rng);
+
+}
 
+// ========================================sort definitions========================================
+SortTask::SortTask(Variable &listToSort, const std::vector<Symbol> &aKeyPath):
+    list(&listToSort),
+    keyPath(aKeyPath)
+{ }
+void SortTask::run()
+{
+    if(list == nullptr)
+    {
+        debugPrint("list is null, cannot sort");
+        return;
+    }
+    ListObjUtils::sort(*list, keyPath);
 }
 
 // ========================================extend definitions========================================
-ExtendTask::ExtendTask(Variable &anAddList, const listObj &someAddElems):
-    addList(anAddList.getBorrowPtr()),
+ExtendTask::ExtendTask(Variable &anAddList, const varType &someAddElems):
+    addList(&anAddList),
     addElems(someAddElems)
 { }
 void ExtendTask::run()
@@ -124,37 +153,47 @@ void ExtendTask::run()
         return;
     }
 
-    std::for_each(addElems.begin(), addElems.end(),
-    [addList = this->addList](const auto &item)
+    auto push = [addList = this->addList](const auto &list)
     {
-        ListObjUtils::push_back(*addList, item->getRef());
-    }); // for_each
+        std::for_each(list.begin(), list.end(),
+        [addList](const auto &item)
+        {
+            if constexpr (std::is_same_v<std::decay_t<decltype(item)>, std::shared_ptr<Variable>>)
+            { ListObjUtils::push_back(*addList, item->getRef()); }
+            else
+            { ListObjUtils::push_back(*addList, item); }
+        }); // for_each
+    };
+    // typed lists push their values as they are, decks push each card as a map
+    if(auto ints = std::get_if<intList>(&addElems)) { push(*ints); }
+    else if(auto strings = std::get_if<stringList>(&addElems)) { push(*strings); }
+    else { push(toListObj(addElems)); }
 }
 
 // ========================================input definitions========================================
-InputTask::InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType,
+InputTask::InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType,
     const playerHandlerPtr &handler):
-    playerList(copyVec<int>(pList)),
+    playerList(pList),
     prompt(aPrompt),
     type(aType),
     playerHandler(handler)
 {  }
-InputTask::InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType,
+InputTask::InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType,
             const playerHandlerPtr &handler, int rangeStart, int rangeEnd):
-    playerList(copyVec<int>(pList)),
+    playerList(pList),
     prompt(aPrompt),
     type(aType),
     playerHandler(handler),
     start(rangeStart),
     end(rangeEnd)
 {  }
-InputTask::InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType,
-    const playerHandlerPtr &handler, const listObj &vals):
-    playerList(copyVec<int>(pList)),
+InputTask::InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType,
+    const playerHandlerPtr &handler, const varType &vals):
+    playerList(pList),
     prompt(aPrompt),
     type(aType),
     playerHandler(handler),
-    choices(copyVec<std::string>(vals))
+    choices(vals)
 { }
 void InputTask::run()
 {
@@ -179,7 +218,8 @@ void InputTask::run()
         }); // accumulate
     };
 
-    std::string ids = std::accumulate(playerList.begin(), playerList.end(), std::string{},
+    auto playerIds = copyVec<int>(playerList);
+    std::string ids = std::accumulate(playerIds.begin(), playerIds.end(), std::string{},
         [](std::string curr, const auto &id) { return curr + "," + std::to_string(id); });
     ids.erase(ids.begin()); // remove first comma
 
@@ -188,21 +228,22 @@ void InputTask::run()
     msg["type"] = type;
 
     setRange(msg, start, end);
-    setChoices(msg, choices);
+    setChoices(msg, copyVec<std::string>(choices));
 
     playerHandler->queueMessage(ids, msg);
 }
 
 // ========================================message definitions========================================
-MessageTask::MessageTask(const playerHandlerPtr &aPlayerHandler, const listObj &aPlayerList,
+MessageTask::MessageTask(const playerHandlerPtr &aPlayerHandler, const varType &aPlayerList,
     std::string_view anMessage):
     playerHandler(std::move(aPlayerHandler)),
-    playerList(copyVec<int>(aPlayerList)),
+    playerList(aPlayerList),
     message(anMessage)
 {}
 void MessageTask::run()
 {
-    std::string ids = std::accumulate(playerList.begin(), playerList.end(), std::string{},
+    auto playerIds = copyVec<int>(playerList);
+    std::string ids = std::accumulate(playerIds.begin(), playerIds.end(), std::string{},
         [](std::string curr, const auto &id) { return curr + "," + std::to_string(id); });
     ids.erase(ids.begin()); // remove first comma
 
@@ -214,25 +255,27 @@ void MessageTask::run()
 
 // ========================================scores definitions========================================
 ScoresTask::ScoresTask(const playerHandlerPtr &aPlayerHandler, const int anOwnerId,
-    const listObj &somePlayerNames, const listObj &someScores, std::string_view anAttribute):
+    const varType &somePlayerNames, const varType &someScores, std::string_view anAttribute):
     playerHandler(aPlayerHandler),
-    playerNames(copyVec<std::string>(somePlayerNames)),
+    playerNames(somePlayerNames),
     playerScores(someScores),
     attrName(anAttribute),
     ownerId(anOwnerId) {}
 void ScoresTask::run()
 {
+    auto names = copyVec<std::string>(playerNames);
     GameInstance::msgType msg;
     msg["type"] = "scores";
     msg["attr"] = attrName;
-    msg["count"] = std::to_string(playerNames.size());
-    std::accumulate(playerNames.begin(), playerNames.end(), 0,
+    msg["count"] = std::to_string(names.size());
+    std::accumulate(names.begin(), names.end(), 0,
         [&](int curr, const auto& name)
         {
             msg["name" + std::to_string(curr)] = name;
             return curr + 1;
         });
-    std::accumulate(playerScores.begin(), playerScores.end(), 0,
+    listObj scores = toListObj(playerScores);
+    std::accumulate(scores.begin(), scores.end(), 0,
         [&](int curr, const auto& scorePtr)
         {
             std::stringstream stream;
@@ -254,12 +297,37 @@ void AssignmentTask::run()
     mgr->setVariable(name, val);
 }
 
+// ========================================discard definitions========================================
+DiscardTask::DiscardTask(Variable &aDiscardFrom, int aNumToDiscard):
+    discardFrom(&aDiscardFrom),
+    numToDiscard(aNumToDiscard)
+{ }
+void DiscardTask::run()
+{
+    if(discardFrom == nullptr)
+    {
+        debugPrint("list is null, cannot discard");
+        return;
+    }
+    // discard the # of elements, not a particular element
+    ListObjUtils::remove(*discardFrom, numToDiscard);
+}
 
-// void DiscardTask::run()
-// {
-//     // discard the # of elements, not a particular element
-//     discardFrom->remove(std::move(numToDiscard));
-// }
+// ========================================deal definitions========================================
+DealTask::DealTask(Variable &aDealFrom, Variable &aDealTo, int aNumToDeal):
+    dealFrom(&aDealFrom),
+    dealTo(&aDealTo),
+    numToDeal(aNumToDeal)
+{ }
+void DealTask::run()
+{
+    if(dealFrom == nullptr || dealTo == nullptr)
+    {
+        debugPrint("list is null, cannot deal");
+        return;
+    }
+    ListObjUtils::deal(*dealFrom, *dealTo, numToDeal);
+}
 
 
 // ============================================factories===========================================
@@ -282,7 +350,32 @@ std::shared_ptr<RunnableTask> DefaultFactory<ShuffleTask>::create(mutableVarPoin
         throw BadVariableArgException("Expected a single argument"); return nullptr;
     }
 
-    return (std::shared_ptr<RunnableTask>) std::make_shared<ShuffleTask>(*vars.at(0));
+    if(rng == nullptr)
+    {
+        throw BadVariableArgException("Expected random generator to be not null"); return nullptr;
+    }
+
+    return (std::shared_ptr<RunnableTask>) std::make_shared<ShuffleTask>(*vars.at(0), rng);
+}
+
+std::shared_ptr<RunnableTask> DefaultFactory<SortTask>::create(mutableVarPointerVector &vars) const
+{
+    // preconditions
+    if(!checkPreconditions(Min(1), Max(2), "Expected a list and an optional key", vars))
+    { return nullptr; }
+
+    std::string* key = nullptr;
+    if(!ListObjUtils::isList(vars.at(0)->getRef()) ||
+       (vars.size() == 2 && (key = std::get_if<std::string>(&vars.at(1)->getRef())) == nullptr))
+    { throw BadVariableArgException("Expected listObj and string"); return nullptr; }
+
+    std::vector<Symbol> keyPath;
+    if(key != nullptr)
+    {
+        for(const auto &name : std::views::split(*key, '.'))
+        { keyPath.emplace_back(std::string_view(name.begin(), name.end())); }
+    }
+    return (std::shared_ptr<RunnableTask>) std::make_shared<SortTask>(*vars.at(0), keyPath);
 }
 
 std::shared_ptr<RunnableTask> DefaultFactory<ExtendTask>::create(mutableVarPointerVector &vars) const
@@ -291,13 +384,12 @@ std::shared_ptr<RunnableTask> DefaultFactory<ExtendTask>::create(mutableVarPoint
     if(!checkPreconditions(Min(2), Max(2), "Expected two Variable arguments", vars))
     { return nullptr; }
 
-    listObj* addElems;
-    if ((           std::get_if<listObj>(&vars.at(0)->getRef())) == nullptr ||
-        (addElems = std::get_if<listObj>(&vars.at(1)->getRef())) == nullptr   )
+    if (!ListObjUtils::isList(vars.at(0)->getRef()) ||
+        !ListObjUtils::isList(vars.at(1)->getRef())   )
     { throw BadVariableArgException("Expected two listObjs");           return nullptr; }
 
     // we need to modify existing variable s pass first arg as reference (and store in resulting object)
-    return (std::shared_ptr<RunnableTask>) std::make_shared<ExtendTask>(*vars.at(0), *addElems);
+    return (std::shared_ptr<RunnableTask>) std::make_shared<ExtendTask>(*vars.at(0), vars.at(1)->getRef());
 }
 
 
@@ -308,11 +400,11 @@ std::shared_ptr<RunnableTask> DefaultFactory<InputTask>::create(mutableVarPointe
     { return nullptr; }
 
     size_t varsSize = vars.size();
-    listObj* playerList;
+    const varType &playerList = vars.at(0)->getRef();
     std::string* prompt;
     std::string* type;
     // check minimum required args
-    if ((playerList = std::get_if   <listObj>       (&vars.at(0)->getRef())) == nullptr ||
+    if (!ListObjUtils::isList(playerList) ||
         (prompt     = std::get_if   <std::string>   (&vars.at(1)->getRef())) == nullptr ||
         (type       = std::get_if   <std::string>   (&vars.at(2)->getRef())) == nullptr   )
     { throw BadVariableArgException("Expected listObj, str, str");                  return nullptr; }
@@ -324,10 +416,10 @@ std::shared_ptr<RunnableTask> DefaultFactory<InputTask>::create(mutableVarPointe
     {
         case inputTypes::CHOICES:
         {
-            if(auto choices = std::get_if<listObj>(&vars.at(varsSize - 1)->getRef()))
+            if(const varType &choices = vars.at(varsSize - 1)->getRef(); ListObjUtils::isList(choices))
             {
-                ret = std::make_shared<InputTask>(*playerList, *prompt, *type, playerHandler,
-                                                *choices);
+                ret = std::make_shared<InputTask>(playerList, *prompt, *type, playerHandler,
+                                                choices);
                 break;
             }
             throw BadVariableArgException("Expected listObj, str, str, listObj");
@@ -339,14 +431,14 @@ std::shared_ptr<RunnableTask> DefaultFactory<InputTask>::create(mutableVarPointe
             if((start  = std::get_if<int>(&vars.at(varsSize - 2)->getRef())) &&
                (end    = std::get_if<int>(&vars.at(varsSize - 1)->getRef()))   )
             {
-                ret = std::make_shared<InputTask>(*playerList, *prompt, *type, playerHandler,
+                ret = std::make_shared<InputTask>(playerList, *prompt, *type, playerHandler,
                                                 *start, *end);
                 break;
             }
             throw BadVariableArgException("Expected listObj, str, str, listObj");
         } break;
         default:
-            ret = std::make_shared<InputTask>(*playerList, *prompt, *type, playerHandler);
+            ret = std::make_shared<InputTask>(playerList, *prompt, *type, playerHandler);
     }
     return ret;
 }
@@ -357,12 +449,12 @@ std::shared_ptr<RunnableTask> DefaultFactory<MessageTask>::create(mutableVarPoin
     if(!checkPreconditions(Min(2), Max(2), "Expected two Variable arguments", vars, playerHandler))
     { return nullptr; }
 
-    listObj* list;
+    const varType &list = vars.at(0)->getRef();
     std::string* addElems;
-    if ((list       = std::get_if<listObj>       (&vars.at(0)->getRef())) &&
+    if (ListObjUtils::isList(list) &&
         (addElems   = std::get_if<std::string>   (&vars.at(1)->getRef()))   )
     {
-        return (std::shared_ptr<RunnableTask>) std::make_shared<MessageTask>(playerHandler, *list, *addElems);
+        return (std::shared_ptr<RunnableTask>) std::make_shared<MessageTask>(playerHandler, list, *addElems);
     }
 
     throw BadVariableArgException("Expected two listObjs");
@@ -375,16 +467,16 @@ std::shared_ptr<RunnableTask> DefaultFactory<ScoresTask>::create(mutableVarPoint
     if(!checkPreconditions(Min(4), Max(4), "Expected four Variable arguments", vars, playerHandler))
     { return nullptr; }
 
-    listObj* nameList;
-    listObj* scoreList;
+    const varType &nameList = vars.at(1)->getRef();
+    const varType &scoreList = vars.at(2)->getRef();
     int* ownerId;
     std::string* attrName;
     if ((ownerId   = std::get_if<int>           (&vars.at(0)->getRef())) &&
-        (nameList  = std::get_if<listObj>       (&vars.at(1)->getRef())) &&
-        (scoreList = std::get_if<listObj>       (&vars.at(2)->getRef())) &&
+        ListObjUtils::isList(nameList) &&
+        ListObjUtils::isList(scoreList) &&
         (attrName  = std::get_if<std::string>   (&vars.at(3)->getRef())))
     {
-        return (std::shared_ptr<RunnableTask>) std::make_shared<ScoresTask>(playerHandler, *ownerId, *nameList, *scoreList, *attrName);
+        return (std::shared_ptr<RunnableTask>) std::make_shared<ScoresTask>(playerHandler, *ownerId, nameList, scoreList, *attrName);
     }
 
     throw BadVariableArgException("Expected listObj, listObj, int, string");
@@ -406,22 +498,34 @@ std::shared_ptr<RunnableTask> DefaultFactory<AssignmentTask>::create(mutableVarP
     return nullptr;
 }
 
-// std::shared_ptr<RunnableTask> DefaultFactory<DiscardTask>::create(mutableVarPointerVector vars) const
-// {
-//     if(vars.size() != 2 ||
-//         (vars.at(0))->type() != variables::Variable::Type::LIST ||
-//         (vars.at(1))->type() != variables::Variable::Type::INT)
-//     {
-//         return nullptr;
-//     }
+std::shared_ptr<RunnableTask> DefaultFactory<DiscardTask>::create(mutableVarPointerVector &vars) const
+{
+    // preconditions
+    if(!checkPreconditions(Min(2), Max(2), "Expected two Variable arguments", vars))
+    { return nullptr; }
+
+    int* numToDiscard;
+    if (!ListObjUtils::isList(vars.at(0)->getRef()) ||
+        (numToDiscard = std::get_if<int>(&vars.at(1)->getRef())) == nullptr)
+    { throw BadVariableArgException("Expected listObj and int"); return nullptr; }
 
-//     std::shared_ptr<variables::listObj> origList = static_pointer_cast<variables::listObj>((vars.at(0))->getReference());
+    return (std::shared_ptr<RunnableTask>) std::make_shared<DiscardTask>(*vars.at(0), *numToDiscard);
+}
 
-//     std::shared_ptr<int> numToDiscard = static_pointer_cast<int>((vars.at(1))->getReference());
+std::shared_ptr<RunnableTask> DefaultFactory<DealTask>::create(mutableVarPointerVector &vars) const
+{
+    // preconditions
+    if(!checkPreconditions(Min(3), Max(3), "Expected three Variable arguments", vars))
+    { return nullptr; }
 
-//     return std::make_shared<DiscardTask>(static_pointer_cast<variables::listObj>(origList), *numToDiscard);
+    int* numToDeal;
+    if (!ListObjUtils::isList(vars.at(0)->getRef()) ||
+        !ListObjUtils::isList(vars.at(1)->getRef()) ||
+        (numToDeal = std::get_if<int>(&vars.at(2)->getRef())) == nullptr)
+    { throw BadVariableArgException("Expected two listObjs and int"); return nullptr; }
 
-// }
+    return (std::shared_ptr<RunnableTask>) std::make_shared<DealTask>(*vars.at(0), *vars.at(1), *numToDeal);
+}
 
 
 // ===========================================converter===========================================
@@ -429,6 +533,8 @@ std::shared_ptr<RunnableTask> SCConverter::convert(std::shared_ptr<RuleNode> tas
 {
     if(factories[task->getType()])
     {
+        // tasks snapshot their list arguments; snapshots taken in the game's arena share storage
+        MemoryResourceGuard guard(src? src->memory.get() : memoryResource());
         std::vector<std::vector<std::string>> neededArgs = task->getData();
         mutableVarPointerVector args = tempArgs[task->getType()];  // [TEMP]
         // [TODO]
@@ -449,19 +555,21 @@ void SCConverter::addFactory(NodeType e, std::shared_ptr<TaskFactory> factory)
 
 SCConverter buildDefaultConverter(std::shared_ptr<GameInstance> game)
 {
-    if(game == nullptr || game->playerHandler == nullptr || game->envMgr == nullptr)
+    if(game == nullptr || game->playerHandler == nullptr || game->envMgr == nullptr || game->rng == nullptr)
     {
-        throw std::runtime_error("game, player handler or envMgr is null");
+        throw std::runtime_error("game, player handler, envMgr or rng is null");
     }
 
     SCConverter converter(std::move(game));
     converter.addFactory(NodeType::REVERSE, std::make_shared<ReverseFactory>());
-    converter.addFactory(NodeType::SHUFFLE, std::make_shared<ShuffleFactory>());
+    converter.addFactory(NodeType::SHUFFLE, std::make_shared<ShuffleFactory>(converter.src->rng));
+    converter.addFactory(NodeType::SORT, std::make_shared<SortFactory>());
     converter.addFactory(NodeType::EXTEND, std::make_shared<ExtendFactory>());
     converter.addFactory(NodeType::INPUT_CHOICE, std::make_shared<InputFactory>(converter.src->playerHandler));
     converter.addFactory(NodeType::MESSAGE, std::make_shared<MessageFactory>(converter.src->playerHandler));
     converter.addFactory(NodeType::SCORES, std::make_shared<ScoresFactory>(converter.src->playerHandler));
     converter.addFactory(NodeType::ASSIGNMENT, std::make_shared<AssignmentFactory>(converter.src->envMgr));
-    // converter.addFactory(Task::Type::DISCARD, std::make_shared<DiscardFactory>());
+    converter.addFactory(NodeType::DISCARD, std::make_shared<DiscardFactory>());
+    converter.addFactory(NodeType::DEAL, std::make_shared<DealFactory>());
     return converter;
 }
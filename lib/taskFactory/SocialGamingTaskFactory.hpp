@@ -17,6 +17,7 @@ class GameInstance;
 using listSharedPtr = std::shared_ptr<listObj>;
 using playerHandlerPtr = std::shared_ptr<PlayerHandler>;
 using environmentMgrPtr = std::shared_ptr<EnvironmentManager>;
+using randomPtr = std::shared_ptr<Random>;
 using ruleNodeType = RuleNode;
 using nodeTypeEnum = NodeType;
 
@@ -42,7 +43,7 @@ class ReverseTask: public RunnableTask
         void run() override;
         int getType() const override { return nodeTypeEnum::REVERSE; }
     private:
-        varTypeBorrowedPtr list;
+        Variable* list;
 };
 template<>
 class DefaultFactory<ReverseTask>: public TaskFactory {
@@ -56,30 +57,53 @@ using ReverseFactory       = DefaultFactory<ReverseTask>;
 class ShuffleTask: public RunnableTask
 {
     public:
-        ShuffleTask(Variable &list);
+        ShuffleTask(Variable &list, const randomPtr &aRng);
         void run() override;
         int getType() const override { return nodeTypeEnum::SHUFFLE; }
     private:
-        varTypeBorrowedPtr list;
+        Variable* list;
+        const randomPtr rng;
 };
 template<>
 class DefaultFactory<ShuffleTask>: public TaskFactory {
     public:
+    DefaultFactory(const randomPtr &aRng):rng(aRng) {}
     std::shared_ptr<RunnableTask> create(mutableVarPointerVector &vars) const override;
+    private:
+    const randomPtr rng;
 };
 using ShuffleFactory       = DefaultFactory<ShuffleTask>;
 
 
+// ========================================sort definitions========================================
+class SortTask: public RunnableTask
+{
+    public:
+        SortTask(Variable &list, const std::vector<Symbol> &aKeyPath);
+        void run() override;
+        int getType() const override { return nodeTypeEnum::SORT; }
+    private:
+        Variable* list;
+        const std::vector<Symbol> keyPath; // "stats.wins" -> {stats, wins}, split once when the task is made
+};
+template<>
+class DefaultFactory<SortTask>: public TaskFactory {
+    public:
+    std::shared_ptr<RunnableTask> create(mutableVarPointerVector &vars) const override;
+};
+using SortFactory       = DefaultFactory<SortTask>;
+
+
 // ========================================extend definitions========================================
 class ExtendTask: public RunnableTask
 {
     public:
-        ExtendTask(Variable &anAddList, const listObj &someAddElems);
+        ExtendTask(Variable &anAddList, const varType &someAddElems);
         void run() override;
         int getType() const override { return nodeTypeEnum::EXTEND; }
     private:
-        varTypeBorrowedPtr addList;
-        const listObj addElems;
+        Variable* addList;
+        const varType addElems; // any list kind, copy on write snapshot
 };
 template<>
 class DefaultFactory<ExtendTask>: public TaskFactory {
@@ -92,24 +116,26 @@ using ExtendFactory       = DefaultFactory<ExtendTask>;
 class InputTask: public RunnableTask
 {
     public:
-        InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler);
-        InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler,
+        InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler);
+        InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler,
                   int rangeStart, int rangeEnd);
-        InputTask(const listObj &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler,
-                  const listObj &vals);
+        InputTask(const varType &pList, std::string_view aPrompt, std::string_view aType, const playerHandlerPtr &handler,
+                  const varType &vals);
 
         void run() override;
         int getType() const override { return nodeTypeEnum::INPUT_CHOICE; }
     private:
+        // lists (listObj, intList, stringList or deckObj) are copy on write snapshots (O(1) to take), converted
+        // when the task runs
         // required
-        const std::vector<int> playerList;
+        const varType playerList;
         const std::string prompt;
         const std::string type;
         const playerHandlerPtr playerHandler;
         // optional
         const int start = -1;
         const int end = -1;
-        const std::vector<std::string> choices;
+        const varType choices = listObj();
 };
 template<>
 class DefaultFactory<InputTask>: public TaskFactory {
@@ -125,12 +151,12 @@ using InputFactory       = DefaultFactory<InputTask>;
 class MessageTask: public RunnableTask
 {
     public:
-        MessageTask(const playerHandlerPtr &aPlayerHandler, const listObj &aPlayerList, std::string_view anMessage);
+        MessageTask(const playerHandlerPtr &aPlayerHandler, const varType &aPlayerList, std::string_view anMessage);
         void run() override;
         int getType() const override { return nodeTypeEnum::MESSAGE; }
     private:
         const playerHandlerPtr playerHandler;
-        const std::vector<int> playerList;
+        const varType playerList; // snapshot of any list kind, converted when the task runs
         const std::string message;
 };
 template<>
@@ -147,14 +173,14 @@ class ScoresTask: public RunnableTask
 {
     public:
         ScoresTask(const playerHandlerPtr &aPlayerHandler, const int anOwnerId,
-                   const listObj &somePlayerNames, const listObj &someScores,
+                   const varType &somePlayerNames, const varType &someScores,
                    std::string_view anAttribute);
         void run() override;
         int getType() const override { return nodeTypeEnum::SCORES; }
     private:
         const playerHandlerPtr playerHandler;
-        const std::vector<std::string> playerNames;
-        const listObj playerScores; // could change so store pointer
+        const varType playerNames; // snapshots of any list kind, converted when the task runs
+        const varType playerScores;
         const std::string attrName;
         const int ownerId;
 };
@@ -192,24 +218,42 @@ using AssignmentFactory       = DefaultFactory<AssignmentTask>;
 
 
 // ========================================discard definitions========================================
-// class DiscardTask: public RunnableTask
-// {
-//     public:
-//         DiscardTask(listSharedPtr discardFrom, int aNumToDiscard):
-//             discardFrom(discardFrom),
-//             numToDiscard(aNumToDiscard) {}
-//         void run() override;
-//     private:
-//         listSharedPtr discardFrom;
-//         int numToDiscard;
-// };
-
-// template<>
-// class DefaultFactory<DiscardTask>: public TaskFactory {
-//     public:
-//     std::shared_ptr<RunnableTask> create(mutableVarPointerVector vars) const override;
-// };
-// using DiscardFactory = DefaultFactory<DiscardTask>;
+class DiscardTask: public RunnableTask
+{
+    public:
+        DiscardTask(Variable &aDiscardFrom, int aNumToDiscard);
+        void run() override;
+        int getType() const override { return nodeTypeEnum::DISCARD; }
+    private:
+        Variable* discardFrom;
+        const int numToDiscard;
+};
+template<>
+class DefaultFactory<DiscardTask>: public TaskFactory {
+    public:
+    std::shared_ptr<RunnableTask> create(mutableVarPointerVector &vars) const override;
+};
+using DiscardFactory       = DefaultFactory<DiscardTask>;
+
+
+// ========================================deal definitions========================================
+class DealTask: public RunnableTask
+{
+    public:
+        DealTask(Variable &aDealFrom, Variable &aDealTo, int aNumToDeal);
+        void run() override;
+        int getType() const override { return nodeTypeEnum::DEAL; }
+    private:
+        Variable* dealFrom;
+        Variable* dealTo;
+        const int numToDeal;
+};
+template<>
+class DefaultFactory<DealTask>: public TaskFactory {
+    public:
+    std::shared_ptr<RunnableTask> create(mutableVarPointerVector &vars) const override;
+};
+using DealFactory       = DefaultFactory<DealTask>;
 
 // converter
 class SCConverter: public Converter<ruleNodeType, nodeTypeEnum, GameInstance>
@@ -219,12 +263,14 @@ class SCConverter: public Converter<ruleNodeType, nodeTypeEnum, GameInstance>
         {
             tempArgs[nodeTypeEnum::REVERSE] = {makeVarPtr(0,1,2,3,4,5,6,7,8,9)};
             tempArgs[nodeTypeEnum::SHUFFLE] = {makeVarPtr(0,1,2,3,4,5,6,7,8,9)};
+            tempArgs[nodeTypeEnum::SORT] = {makeVarPtr(5,3,8,1,9,0)};
             tempArgs[nodeTypeEnum::EXTEND] = {makeVarPtr(1,2,3), makeVarPtr(4,5,6)};
             tempArgs[nodeTypeEnum::INPUT_CHOICE] = {makeVarPtr(1,2,3), makeVarPtr("test prompt"), makeVarPtr("input")};
             tempArgs[nodeTypeEnum::SCORES] = {makeVarPtr(0), makeVarPtr("player1", "player2", "player3"),
                                             makeVarPtr(100, 200, 50), makeVarPtr("points")};
             tempArgs[nodeTypeEnum::MESSAGE] = {makeVarPtr(1,2,3), makeVarPtr("test message!")};
             tempArgs[nodeTypeEnum::DISCARD] = {makeVarPtr(1,2,3), makeVarPtr(1)};
+            tempArgs[nodeTypeEnum::DEAL] = {makeVarPtr(1,2,3,4,5), makeVarPtr(listObj()), makeVarPtr(2)};
             tempArgs[nodeTypeEnum::ASSIGNMENT] = {makeVarPtr("test"), makeVarPtr(1)};
         }
         std::shared_ptr<RunnableTask> convert(std::shared_ptr<ruleNodeType> task) override;
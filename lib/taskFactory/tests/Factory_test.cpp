@@ -88,6 +88,108 @@ TEST_F(TasksBasicTestFixture, shuffleTest)
     ASSERT_NE("0, 1, 2, 3, 4, 5, 6, 7, 8, 9, ", output);
 }
 
+TEST_F(TasksBasicTestFixture, sortTest)
+{
+    // init
+    SetUp(NodeType::SORT);
+
+    // precondition
+    std::shared_ptr<Variable> eList = (converter.tempArgs.at(NodeType::SORT).at(0));
+    ASSERT_EQ(6, eList->size());
+    ASSERT_EQ(NodeType::SORT, runnableTask->getType());
+
+    // execute
+    runnableTask->run();
+
+    // assert
+    testing::internal::CaptureStdout();
+    eList->print();
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_EQ("0, 1, 3, 5, 8, 9, ", output);
+}
+
+TEST_F(TasksBasicTestFixture, sortKeyTest)
+{
+    // init
+    std::vector<std::string> names = {"Ringo", "John", "Paul", "George"};
+    std::vector<int> wins = {2, 0, 2, 1};
+    listObj players;
+    for(size_t i = 0; i < names.size(); i++)
+    {
+        varMapType stats;
+        stats[Symbol("wins")] = makeVarPtr(wins[i]);
+        varMapType player;
+        player[Symbol("name")] = makeVarPtr(names[i]);
+        player[Symbol("stats")] = makeVarPtr(stats);
+        players.push_back(makeVarPtr(player));
+    }
+    players.push_back(makeVarPtr(varMapType())); // no wins, goes last
+    std::shared_ptr<Variable> eList = makeVarPtr(players);
+    converter.tempArgs[NodeType::SORT] = {eList, makeVarPtr("stats.wins")};
+    SetUp(NodeType::SORT);
+
+    // execute
+    runnableTask->run();
+
+    // assert: equal keys keep their order
+    std::vector<std::string> expected = {"John", "George", "Ringo", "Paul"};
+    for(size_t i = 0; i < expected.size(); i++)
+    {
+        auto player = ListObjUtils::get_at(eList->getRef(), (int) i);
+        ASSERT_TRUE(VariableUtils::getVarWithKey(player->getRef(), Symbol("name"))->isEqual(expected[i]));
+    }
+    ASSERT_EQ(0, ListObjUtils::get_at(eList->getRef(), 4)->size());
+
+    converter.tempArgs[NodeType::SORT] = {eList, makeVarPtr(1)};
+    ASSERT_THROW(converter.convert(parsedtask), BadVariableArgException);
+}
+
+TEST_F(TasksBasicTestFixture, discardTest)
+{
+    // init
+    SetUp(NodeType::DISCARD);
+
+    // precondition
+    std::shared_ptr<Variable> eList = (converter.tempArgs.at(NodeType::DISCARD).at(0));
+    ASSERT_EQ(3, eList->size());
+    ASSERT_EQ(NodeType::DISCARD, runnableTask->getType());
+
+    // execute
+    runnableTask->run();
+
+    // assert
+    testing::internal::CaptureStdout();
+    eList->print();
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_EQ("2, 3, ", output);
+}
+
+TEST_F(TasksBasicTestFixture, dealTest)
+{
+    // init
+    SetUp(NodeType::DEAL);
+
+    // precondition
+    std::shared_ptr<Variable> deck = (converter.tempArgs.at(NodeType::DEAL).at(0));
+    std::shared_ptr<Variable> hand = (converter.tempArgs.at(NodeType::DEAL).at(1));
+    std::shared_ptr<Variable> top = ListObjUtils::get_at(deck->getRef(), 0);
+    ASSERT_EQ(5, deck->size());
+    ASSERT_EQ(0, hand->size());
+    ASSERT_EQ(NodeType::DEAL, runnableTask->getType());
+
+    // execute
+    runnableTask->run();
+    runnableTask->run();
+
+    // assert
+    testing::internal::CaptureStdout();
+    deck->print();
+    hand->print();
+    std::string output = testing::internal::GetCapturedStdout();
+    ASSERT_EQ("5, 1, 2, 3, 4, ", output);
+    ASSERT_EQ(top, ListObjUtils::get_at(hand->getRef(), 0)); // same Variable, not a copy
+}
+
 TEST_F(TasksBasicTestFixture, extendTest)
 {
     // init
@@ -246,3 +348,65 @@ TEST_F(TasksBasicTestFixture, assignmentTest)
     runnableTask->run();
     ASSERT_TRUE(game->envMgr->getVariable("test")->isEqual(1));
 }
+
+TEST_F(TasksBasicTestFixture, typedListArgsTest)
+{
+    // init
+    // lists from getElements, projections like players.name and compiled settings are typed
+    std::shared_ptr<Variable> eList = makeVarPtr(intList{1, 2, 3});
+    converter.tempArgs[NodeType::EXTEND] = {eList, makeVarPtr(intList{4, 5})};
+    converter.tempArgs[NodeType::MESSAGE] = {makeVarPtr(intList{1, 2, 3}), makeVarPtr("test message!")};
+    converter.tempArgs[NodeType::SCORES] = {makeVarPtr(0), makeVarPtr(stringList{"player1", "player2"}),
+                                            makeVarPtr(intList{100, 200}), makeVarPtr("points")};
+
+    // execute
+    SetUp(NodeType::EXTEND);
+    runnableTask->run();
+    SetUp(NodeType::MESSAGE);
+    runnableTask->run();
+    SetUp(NodeType::SCORES);
+    runnableTask->run();
+
+    // assert
+    ASSERT_EQ(Type::INT_LIST, eList->type());
+    ASSERT_EQ(5, eList->size());
+    ASSERT_TRUE(ListObjUtils::contains(eList->getRef(), 5));
+
+    std::vector<GameInstance::Msg> expected;
+    expected.push_back(GameInstance::Msg("1,2,3", {{"type", "message"}, {"data", "test message!"}}));
+    expected.push_back(GameInstance::Msg("0",
+        {   {"type",    "scores"},
+            {"attr",    "points"},
+            {"count",   "2"},
+            {"name0",   "player1"},
+            {"name1",   "player2"},
+            {"score0",  "100"},
+            {"score1",  "200"}
+        }));
+    ASSERT_EQ(expected, game->playerHandler->getAllMsgs());
+}
+
+TEST(TasksTest, outliveGameTest)
+{
+    // a task's snapshot of a list shares the game's storage, so it keeps the game's arena alive
+    auto game = std::make_shared<GameInstance>("outlive", 0);
+    std::shared_ptr<RunnableTask> task;
+    {
+        SCConverter converter = buildDefaultConverter(game);
+        std::shared_ptr<Variable> players;
+        {
+            MemoryResourceGuard guard(game->memory.get());
+            listObj ids; // storage in the game's arena, elements from the heap
+            for(int id : {1, 2, 3}) { ids.push_back(std::make_shared<Variable>(id)); }
+            players = makeVarPtr(ids);
+        }
+        converter.tempArgs[NodeType::MESSAGE] = {players, makeVarPtr("test message!")};
+        task = converter.convert(std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE));
+    }
+    auto playerHandler = game->playerHandler;
+    game.reset();
+
+    task->run();
+    std::vector<GameInstance::Msg> expected = {GameInstance::Msg("1,2,3", {{"type", "message"}, {"data", "test message!"}})};
+    ASSERT_EQ(expected, playerHandler->getAllMsgs());
+}
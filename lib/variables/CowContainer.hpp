@@ -0,0 +1,301 @@
+#ifndef COW_CONTAINER_H
+#define COW_CONTAINER_H
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+#include <initializer_list>
+
+
+namespace var {
+// copy on write storage: copies share one Container until either side is written to.
+// reads (const access) never copy, the first write through a shared copy clones it (O(n) once).
+// storage is only shared between copies that use the same memory resource, so a copy taken outside a game's
+// arena still owns its own memory. don't hold non-const iterators/references across a copy of the container
+template <typename Container>
+class CowStorage
+{
+    public:
+        using allocator_type = typename Container::allocator_type;
+
+        CowStorage() = default;
+        explicit CowStorage(const allocator_type &anAlloc): alloc(anAlloc) {}
+        CowStorage(const CowStorage &other):
+            alloc(other.alloc.select_on_container_copy_construction()),
+            data(shareFrom(other))
+        { }
+        CowStorage(CowStorage &&other) noexcept = default;
+        CowStorage& operator=(const CowStorage &other)
+        {
+            if(this != &other) { data = shareFrom(other); }
+            return *this;
+        }
+        CowStorage& operator=(CowStorage &&other)
+        {
+            data = alloc.resource() == other.alloc.resource()? std::move(other.data) : shareFrom(other);
+            return *this;
+        }
+
+        allocator_type get_allocator() const { return alloc; }
+        // true if another copy currently shares this storage
+        bool isShared() const { return data.use_count() > 1; }
+
+    protected:
+        const Container& read() const { return data? *data : emptyContainer(); }
+        Container& write()
+        {
+            if(data == nullptr)
+            { data = std::allocate_shared<Container>(alloc, alloc); }
+            else if(isShared())
+            { data = std::allocate_shared<Container>(alloc, *data, alloc); }
+            return *data;
+        }
+        bool sameStorage(const CowStorage &other) const { return data != nullptr && data == other.data; }
+
+    private:
+        std::shared_ptr<Container> shareFrom(const CowStorage &other) const
+        {
+            if(other.data == nullptr) { return nullptr; }
+            if(alloc.resource() == other.alloc.resource()) { return other.data; }
+            return std::allocate_shared<Container>(alloc, *other.data, alloc);
+        }
+        static const Container& emptyContainer()
+        {
+            static const Container container;
+            return container;
+        }
+
+        allocator_type alloc;
+        std::shared_ptr<Container> data; // null until first write
+};
+
+
+// default membership index of a CowList: a hash set of its values. value types can't change without the list
+// changing, so it's current until the list drops it
+template <typename T, typename Alloc>
+class HashIndex
+{
+    public:
+        template <typename List>
+        explicit HashIndex(const List &list):
+            items(list.begin(), list.end(), 0, std::hash<T>(), std::equal_to<T>(), list.get_allocator()) {}
+        template <typename List>
+        bool current(const List&) const { return true; }
+        bool contains(const T &item) const { return items.contains(item); }
+    private:
+        std::unordered_set<T, std::hash<T>, std::equal_to<T>, Alloc> items;
+};
+
+
+// std::vector interface over CowStorage. non-const access detaches.
+// erase_front() is amortized O(k) in the k items dropped: the list starts at an offset (head) into its storage
+// instead of shifting the rest, and the unused prefix is only compacted once it outgrows the list. like any
+// other write it drops the membership index, so the next contains() on a big list rebuilds it in O(n)
+template <typename T, typename Alloc, typename Index = HashIndex<T, Alloc>>
+class CowList: public CowStorage<std::vector<T, Alloc>>
+{
+    private:
+        using vecType = std::vector<T, Alloc>;
+        using base = CowStorage<vecType>;
+    public:
+        using value_type = T;
+        using size_type = typename vecType::size_type;
+        using reference = T&;
+        using const_reference = const T&;
+        using iterator = typename vecType::iterator;
+        using const_iterator = typename vecType::const_iterator;
+
+        using base::base;
+        CowList() = default;
+        CowList(std::initializer_list<T> items) { mutate().assign(items); }
+        CowList(const CowList &other) = default;
+        CowList(CowList &&other) noexcept:
+            base(std::move(other)), index(std::move(other.index)), head(std::exchange(other.head, 0))
+        { }
+        CowList& operator=(const CowList &other) = default;
+        CowList& operator=(CowList &&other)
+        {
+            base::operator=(std::move(other)); // copies instead if the resources differ
+            index = other.index;
+            head = other.head;
+            if(other.read().size() < other.head) { other.head = 0; }
+            return *this;
+        }
+
+        iterator begin() { return mutate().begin() + head; }
+        iterator end() { return mutate().end(); }
+        const_iterator begin() const { return this->read().begin() + head; }
+        const_iterator end() const { return this->read().end(); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        T* data() { return mutate().data() + head; }
+        const T* data() const { return this->read().data() + head; }
+        size_type size() const { return this->read().size() - head; }
+        bool empty() const { return size() == 0; }
+        size_type capacity() const { return this->read().capacity() - head; }
+        void reserve(size_type n) { mutate().reserve(n + head); }
+        void clear()
+        {
+            mutate().clear();
+            head = 0;
+        }
+
+        reference operator[](size_type i) { return mutate()[head + i]; }
+        const_reference operator[](size_type i) const { return this->read()[head + i]; }
+        reference at(size_type i) { checkIndex(i); return (*this)[i]; }
+        const_reference at(size_type i) const { checkIndex(i); return (*this)[i]; }
+        reference front() { return (*this)[0]; }
+        const_reference front() const { return (*this)[0]; }
+        reference back() { return mutate().back(); }
+        const_reference back() const { return this->read().back(); }
+
+        void push_back(const T &item) { mutate().push_back(item); }
+        void push_back(T &&item) { mutate().push_back(std::move(item)); }
+        template <typename... Args>
+        reference emplace_back(Args&&... args) { return mutate().emplace_back(std::forward<Args>(args)...); }
+        void pop_back() { mutate().pop_back(); }
+
+        // drops the first n items (all if n > size()). items are released now unless another copy shares them.
+        // the index is dropped rather than trimmed: HashIndex doesn't count duplicates, and deals/discards are
+        // rarely followed by a contains() before the next write anyway
+        void erase_front(size_type n)
+        {
+            n = std::min(n, size());
+            index.reset();
+            if(!this->isShared())
+            {
+                auto &vec = mutate();
+                std::fill_n(vec.begin() + head, n, T());
+                head += n;
+                if(head >= size()) // amortized: the items moved are fewer than the ones dropped since last time
+                {
+                    vec.erase(vec.begin(), vec.begin() + head);
+                    head = 0;
+                }
+                return;
+            }
+            head += n;
+        }
+
+        // positions are offsets, so a const_iterator taken before the list detached still works
+        iterator insert(const_iterator pos, const T &item)
+        {
+            auto offset = pos - this->read().begin();
+            auto &vec = mutate();
+            return vec.insert(vec.begin() + offset, item);
+        }
+        template <typename InputIt>
+        iterator insert(const_iterator pos, InputIt first, InputIt last)
+        {
+            auto offset = pos - this->read().begin();
+            auto &vec = mutate();
+            return vec.insert(vec.begin() + offset, first, last);
+        }
+        iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            auto offset = first - this->read().begin();
+            auto count = last - first;
+            auto &vec = mutate();
+            return vec.erase(vec.begin() + offset, vec.begin() + offset + count);
+        }
+
+        bool operator==(const CowList &other) const
+        {
+            return (this->sameStorage(other) && head == other.head) ||
+                std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+        // membership index, built on first use and kept until the next non-const access or until Index::current()
+        // says the items changed behind the list's back. only worth it from indexThreshold items up
+        static constexpr size_type indexThreshold = 32;
+        const Index& getIndex() const
+        {
+            if(index == nullptr || !index->current(*this))
+            { index = std::allocate_shared<Index>(this->get_allocator(), *this); }
+            return *index;
+        }
+        bool isIndexed() const { return index != nullptr; }
+        // membership test for value types, scans lists under indexThreshold items
+        bool contains(const T &item) const
+        {
+            if(size() < indexThreshold)
+            { return std::find(begin(), end(), item) != end(); }
+            return getIndex().contains(item);
+        }
+
+    private:
+        mutable std::shared_ptr<const Index> index; // lazily built by getIndex()
+        size_type head = 0; // storage items before this were erased from the front
+
+        vecType& mutate()
+        {
+            index.reset();
+            return this->write();
+        }
+        void checkIndex(size_type i) const
+        {
+            if(i >= size()) { throw std::out_of_range("CowList::at: index out of range"); }
+        }
+};
+
+
+// map interface (FlatMap) over CowStorage. non-const access detaches
+template <typename Map>
+class CowMap: public CowStorage<Map>
+{
+    private:
+        using base = CowStorage<Map>;
+    public:
+        using key_type = typename Map::key_type;
+        using mapped_type = typename Map::mapped_type;
+        using value_type = typename Map::value_type;
+        using size_type = typename Map::size_type;
+        using iterator = typename Map::iterator;
+        using const_iterator = typename Map::const_iterator;
+
+        using base::base;
+        CowMap() = default;
+        CowMap(std::initializer_list<value_type> items)
+        {
+            auto &map = this->write();
+            for(const auto &item: items) { map.insert(item); }
+        }
+
+        iterator begin() { return this->write().begin(); }
+        iterator end() { return this->write().end(); }
+        const_iterator begin() const { return this->read().begin(); }
+        const_iterator end() const { return this->read().end(); }
+
+        size_type size() const { return this->read().size(); }
+        bool empty() const { return this->read().empty(); }
+        void clear() { this->write().clear(); }
+
+        iterator find(const key_type &key) { return this->write().find(key); }
+        const_iterator find(const key_type &key) const { return this->read().find(key); }
+        size_type count(const key_type &key) const { return this->read().count(key); }
+        bool contains(const key_type &key) const { return this->read().contains(key); }
+        mapped_type& at(const key_type &key) { return this->write().at(key); }
+        const mapped_type& at(const key_type &key) const { return this->read().at(key); }
+        mapped_type& operator[](const key_type &key) { return this->write()[key]; }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const key_type &key, Args&&... args)
+        { return this->write().try_emplace(key, std::forward<Args>(args)...); }
+        std::pair<iterator, bool> insert(const value_type &item) { return this->write().insert(item); }
+        size_type erase(const key_type &key) { return contains(key)? this->write().erase(key) : 0; }
+        iterator erase(const_iterator pos)
+        {
+            auto offset = pos - this->read().begin();
+            auto &map = this->write();
+            return map.erase(map.begin() + offset);
+        }
+
+        bool operator==(const CowMap &other) const { return this->sameStorage(other) || this->read() == other.read(); }
+};
+};
+
+#endif
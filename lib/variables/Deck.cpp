@@ -0,0 +1,39 @@
+#include "Deck.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+
+using namespace var;
+
+CardTable::CardTable(std::vector<Card> someCards): cards(std::move(someCards))
+{
+    if(cards.size() > 256)
+    { throw std::length_error("a card table holds at most 256 cards"); }
+}
+
+std::shared_ptr<const CardTable> CardTable::standard()
+{
+    static const std::shared_ptr<const CardTable> table = []()
+    {
+        const std::array<std::string, 4> suits = {"Clubs", "Diamonds", "Hearts", "Spades"};
+        const std::array<std::string, 13> ranks = {"2", "3", "4", "5", "6", "7", "8", "9", "10",
+                                                   "Jack", "Queen", "King", "Ace"};
+        std::vector<Card> cards;
+        for(const auto &suit : suits)
+        {
+            for(size_t i = 0; i < ranks.size(); i++)
+            { cards.push_back({(int) i + 2, suit, ranks[i] + " of " + suit}); }
+        }
+        return std::make_shared<const CardTable>(std::move(cards));
+    }();
+    return table;
+}
+
+std::optional<uint8_t> CardTable::find(std::string_view name) const
+{
+    auto it = std::find_if(cards.begin(), cards.end(), [&name](const Card &card) { return card.name == name; });
+    if(it == cards.end())
+    { return std::nullopt; }
+    return (uint8_t) (it - cards.begin());
+}
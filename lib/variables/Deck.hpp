@@ -0,0 +1,124 @@
+#ifndef DECK_H
+#define DECK_H
+#include "CowContainer.hpp"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace var {
+struct Card
+{
+    int rank;
+    std::string suit;
+    std::string name;
+
+    bool operator==(const Card &other) const = default;
+};
+
+// attributes of every card code a deck can hold (at most 256). tables are immutable and shared by every deck
+// made from them, so a deck only stores one byte per card
+class CardTable
+{
+    public:
+        explicit CardTable(std::vector<Card> someCards); // throws std::length_error if more than 256 cards
+        // 52 cards ordered by suit then rank: "2 of Clubs" (rank 2) ... "Ace of Spades" (rank 14)
+        static std::shared_ptr<const CardTable> standard();
+
+        size_t size() const { return cards.size(); }
+        const Card& operator[](uint8_t code) const { return cards[code]; }
+        std::optional<uint8_t> find(std::string_view name) const; // code of the card with that name
+        bool operator==(const CardTable &other) const { return cards == other.cards; }
+    private:
+        std::vector<Card> cards;
+};
+
+template <typename Alloc>
+struct DeckCards
+{
+    using allocator_type = Alloc;
+
+    DeckCards(const allocator_type &alloc = allocator_type()): codes(alloc) {}
+    DeckCards(const DeckCards &other, const allocator_type &alloc): codes(other.codes, alloc), table(other.table) {}
+
+    std::vector<uint8_t, Alloc> codes;
+    std::shared_ptr<const CardTable> table;
+};
+
+// packed deck: card codes into a CardTable, copy on write like CowList. iterates over codes,
+// card(i) gives the attributes. a 52 card deck is 52 bytes plus the shared table
+template <typename Alloc>
+class CardDeck: public CowStorage<DeckCards<Alloc>>
+{
+    private:
+        using base = CowStorage<DeckCards<Alloc>>;
+        using vecType = std::vector<uint8_t, Alloc>;
+    public:
+        using value_type = uint8_t;
+        using size_type = typename vecType::size_type;
+        using iterator = typename vecType::iterator;
+        using const_iterator = typename vecType::const_iterator;
+
+        using base::base;
+        CardDeck() = default;
+        // one of every card in table order
+        explicit CardDeck(std::shared_ptr<const CardTable> aTable)
+        {
+            auto &cards = this->write();
+            cards.table = std::move(aTable);
+            for(size_t code = 0; cards.table && code < cards.table->size(); code++) { cards.codes.push_back(code); }
+        }
+
+        const std::shared_ptr<const CardTable>& table() const { return this->read().table; }
+        void setTable(std::shared_ptr<const CardTable> aTable) { this->write().table = std::move(aTable); }
+
+        iterator begin() { return this->write().codes.begin(); }
+        iterator end() { return this->write().codes.end(); }
+        const_iterator begin() const { return this->read().codes.begin(); }
+        const_iterator end() const { return this->read().codes.end(); }
+        size_type size() const { return this->read().codes.size(); }
+        bool empty() const { return size() == 0; }
+
+        uint8_t operator[](size_type i) const { return this->read().codes[i]; }
+        const Card& card(size_type i) const { return (*table())[(*this)[i]]; }
+
+        void push_back(uint8_t code) { this->write().codes.push_back(code); }
+        template <typename InputIt>
+        void append(InputIt first, InputIt last)
+        {
+            auto &codes = this->write().codes;
+            codes.insert(codes.end(), first, last);
+        }
+        iterator erase(const_iterator pos)
+        {
+            auto offset = pos - this->read().codes.begin();
+            auto &codes = this->write().codes;
+            return codes.erase(codes.begin() + offset);
+        }
+        // codes are one byte each, so moving the rest down is a short memmove
+        void erase_front(size_type n)
+        {
+            auto &codes = this->write().codes;
+            codes.erase(codes.begin(), codes.begin() + std::min(n, codes.size()));
+        }
+
+        bool contains(std::string_view name) const
+        {
+            auto code = table()? table()->find(name) : std::nullopt;
+            return code && std::find(begin(), end(), *code) != end();
+        }
+
+        bool operator==(const CardDeck &other) const
+        {
+            if(empty() && other.empty()) { return true; }
+            if(this->sameStorage(other)) { return true; }
+            bool sameTable = table() == other.table() || (table() && other.table() && *table() == *other.table());
+            return sameTable && this->read().codes == other.read().codes;
+        }
+};
+};
+
+#endif
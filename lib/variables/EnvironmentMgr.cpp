@@ -1,17 +1,11 @@
 #include "EnvironmentMgr.hpp"
+#include "Expression.hpp"
 
 
 using namespace env_mgr;
 
 
 // ===========================================Timer================================================
-time_t getTime(unsigned int seconds)
-{
-    std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-    std::chrono::system_clock::time_point end = now + std::chrono::seconds(seconds);
-    return std::chrono::system_clock::to_time_t(end);
-}
-
 Timer::Timer() { }
 Timer::Timer(const Timer &other):
     id(other.id),
@@ -22,6 +16,11 @@ Timer::Timer(const Timer &other):
     { }
 
 Timer::Timer(int anId, const std::shared_ptr<RuleNode> &next, int aduration, Type aType, std::string aflagName):
+    Timer(anId, next, std::chrono::seconds(aduration), aType, aflagName)
+    { }
+
+Timer::Timer(int anId, const std::shared_ptr<RuleNode> &next, std::chrono::milliseconds aduration, Type aType,
+             std::string aflagName):
     id(anId),
     nextRuleNode(next),
     type(aType),
@@ -29,63 +28,209 @@ Timer::Timer(int anId, const std::shared_ptr<RuleNode> &next, int aduration, Typ
     duration(aduration)
     { }
 bool Timer::hasFlag() const { return flagName != ""; }
-void Timer::start() { expireTime = getTime(duration); }
-
-bool Timer::isExpired() const
+void Timer::start()
 {
-    std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-    time_t now_t = std::chrono::system_clock::to_time_t(now);
-    return difftime(expireTime, now_t) < 0;
+    deadline = std::chrono::steady_clock::now() + duration;
+    expireTime = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() + duration);
 }
 
+bool Timer::isExpired() const { return std::chrono::steady_clock::now() >= deadline; }
+
 
 // ================================================Scope===========================================
-void Scope::setVariable(std::string_view name, const std::shared_ptr<Variable> &value)
-{ variables[std::string(name)] = value; }
+void Scope::setVariable(Symbol name, const std::shared_ptr<Variable> &value)
+{
+    int slot = slotOf(name);
+    if(slot >= 0) { slots[slot] = value; }
+    else { variables[name] = value; }
+}
 
-std::shared_ptr<Variable> Scope::getVariable(std::string_view name) const
+std::shared_ptr<Variable> Scope::getVariable(Symbol name) const
 {
-    auto it = variables.find(std::string(name));
+    int slot = slotOf(name);
+    if(slot >= 0)
+    { return slots[slot]; }
+    auto it = variables.find(name);
     return it == variables.end()? nullptr : it->second;
 }
 
-bool Scope::hasVar(std::string_view name) const { return variables.find(std::string(name)) != variables.end(); }
-ControlFlow* Scope::getCtrlFlow() { return ctrlFlow.get(); }
+Variable* Scope::borrowVariable(Symbol name) const
+{
+    int slot = slotOf(name);
+    if(slot >= 0)
+    { return slots[slot].get(); }
+    auto it = variables.find(name);
+    return it == variables.end()? nullptr : it->second.get();
+}
+
+bool Scope::hasVar(Symbol name) const
+{
+    int slot = slotOf(name);
+    return slot >= 0? slots[slot] != nullptr : variables.find(name) != variables.end();
+}
+ControlFlow* Scope::getCtrlFlow() { return ctrlFlow? &*ctrlFlow : nullptr; }
+
+void Scope::setSlots(const std::vector<Symbol>* names)
+{
+    varMapType current = allVariables();
+    clear();
+    slotNames = names;
+    slots.assign(names? names->size() : 0, nullptr);
+    for(const auto &[name, value] : current) { setVariable(name, value); }
+}
+
+// scopes have a handful of slots at most, a scan beats hashing
+int Scope::slotOf(Symbol name) const
+{
+    if(!slotNames)
+    { return -1; }
+    auto it = std::find(slotNames->begin(), slotNames->end(), name);
+    return (it == slotNames->end() || (size_t) (it - slotNames->begin()) >= slots.size())? -1 : it - slotNames->begin();
+}
+
+std::shared_ptr<Variable>* Scope::findSlot(Symbol name, uint16_t index)
+{
+    if(index >= slots.size() || (*slotNames)[index] != name)
+    { return nullptr; }
+    return &slots[index];
+}
+
+varMapType Scope::allVariables() const
+{
+    varMapType all;
+    for(size_t i = 0; i < slots.size(); i++)
+    {
+        if(slots[i]) { all[(*slotNames)[i]] = slots[i]; }
+    }
+    for(const auto &[name, value] : variables) { all[name] = value; }
+    return all;
+}
+
+void Scope::clear()
+{
+    if(!variables.empty()) { variables.clear(); }
+    std::fill(slots.begin(), slots.end(), nullptr);
+}
+
+void Scope::reset(const std::shared_ptr<RuleNode> &node, EnvironmentManager* mgr)
+{
+    recycle();
+    isParallel = node? node->getType() == NodeType::PARALLEL : false;
+    ctrlFlow.emplace(node, mgr);
+    if(node) { setSlots(&node->getScopeNames()); }
+}
+
+void Scope::recycle()
+{
+    clear();
+    ctrlFlow.reset();
+    slotNames = nullptr;
+    slots.clear();
+    timerId = -1;
+    isParallel = false;
+}
 
 
 // =========================================EnvironmentManager=====================================
-EnvironmentManager::EnvironmentManager()
-{ scopes.push_front(std::make_unique<Scope>(this)); }
+EnvironmentManager::EnvironmentManager(std::shared_ptr<std::pmr::memory_resource> amemory):
+    memory(std::move(amemory))
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    scopes.push_back(std::make_unique<Scope>(this));
+    scopeCount = 1;
+}
+
+EnvironmentManager::~EnvironmentManager() { setTimerWheel(nullptr, 0); }
+
+void EnvironmentManager::setTimerWheel(std::shared_ptr<TimerWheel> awheel, int owner)
+{
+    for(auto &[id, timer] : timers)
+    {
+        if(wheel) { wheel->cancel(timer->wheelId); }
+        timer->wheelId = 0;
+    }
+    wheel = std::move(awheel);
+    wheelOwner = owner;
+    for(auto &[id, timer] : timers) { startTimer(*timer, true); }
+}
+
+void EnvironmentManager::startTimer(Timer &timer, bool resume)
+{
+    if(!resume)
+    { timer.start(); }
+    if(wheel)
+    {
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(timer.deadline - std::chrono::steady_clock::now());
+        timer.wheelId = wheel->schedule(wheelOwner, timer.id, remaining);
+    }
+}
+
+void EnvironmentManager::dropTimer(int timerId)
+{
+    auto it = timers.find(timerId);
+    if(it == timers.end())
+    { return; }
+    if(wheel) { wheel->cancel(it->second->wheelId); }
+    timers.erase(it);
+}
+
+Scope& EnvironmentManager::nextFrame(const std::shared_ptr<RuleNode> &node)
+{
+    if(scopeCount == scopes.size())
+    { scopes.push_back(std::make_unique<Scope>(this)); }
+    Scope &scope = *scopes[scopeCount];
+    scope.reset(node, this);
+    return scope;
+}
+
+Scope* EnvironmentManager::innermost() const { return scopeCount? scopes[scopeCount - 1].get() : nullptr; }
+
+void EnvironmentManager::reset()
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    for(size_t i = 0; i < scopeCount; i++) { scopes[i]->recycle(); }
+    if(scopes.empty()) { scopes.push_back(std::make_unique<Scope>(this)); }
+    scopeCount = 1;
+    scopes.front()->setSlots(&globalNames);
+    while(!timers.empty()) { dropTimer(timers.begin()->first); }
+    clearCache();
+}
+
+std::pmr::memory_resource* EnvironmentManager::getMemoryResource() const
+{ return memory? memory.get() : std::pmr::new_delete_resource(); }
 
 void EnvironmentManager::enterScope(const std::shared_ptr<RuleNode> &node, const Timer &timer)
 {
-    auto newScope = std::make_unique<Scope>(node, this);
-    newScope->timerId = timer.id;
+    MemoryResourceGuard guard(getMemoryResource());
+    Scope &newScope = nextFrame(node);
+    newScope.timerId = timer.id;
+    dropTimer(timer.id);
     timers[timer.id] = std::make_unique<Timer>(timer);
-    timers.at(timer.id)->scopeid = scopes.size();
+    timers.at(timer.id)->scopeid = scopeCount;
 
     if(timer.hasFlag())
     {
         setVariable(timer.flagName, makeVar(false));
     }
-    timers.at(timer.id)->start();
+    startTimer(*timers.at(timer.id));
 
-    scopes.emplace_front(std::move(newScope));
+    scopeCount++;
 }
 
 std::shared_ptr<RuleNode> EnvironmentManager::enterScope(const std::shared_ptr<RuleNode> &node)
 {
+    MemoryResourceGuard guard(getMemoryResource());
     ControlFlow* currScopeCtrlFlow;
-    if(!scopes.empty() &&
-       (currScopeCtrlFlow = scopes.front()->getCtrlFlow()) &&
+    if(scopeCount != 0 &&
+       (currScopeCtrlFlow = innermost()->getCtrlFlow()) &&
        currScopeCtrlFlow->getNode() == node)
     {
         return currScopeCtrlFlow->updateLoop(); // will return either loop child or loop sibling
     }
 
-    auto newScope = std::make_unique<Scope>(node, this);
-    auto next = (currScopeCtrlFlow = newScope->getCtrlFlow())? currScopeCtrlFlow->getNext() : nullptr;
-    scopes.emplace_front(std::move(newScope)); // make sure is before updateLoop so loop variable is put in right scope
+    Scope &newScope = nextFrame(node);
+    auto next = (currScopeCtrlFlow = newScope.getCtrlFlow())? currScopeCtrlFlow->getNext() : nullptr;
+    scopeCount++; // make sure is before updateLoop so loop variable is put in right scope
 
     if(!node)
     { return next; }
@@ -94,13 +239,41 @@ std::shared_ptr<RuleNode> EnvironmentManager::enterScope(const std::shared_ptr<R
     return (nodeType == NodeType::FOR || nodeType == NodeType::PARALLEL)? currScopeCtrlFlow->updateLoop() : next;
 }
 
+void EnvironmentManager::pushScope(const std::shared_ptr<RuleNode> &node)
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    nextFrame(node);
+    scopeCount++;
+}
+
+bool EnvironmentManager::nextElement()
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    Scope* scope = innermost();
+    ControlFlow* loop = scope? scope->getCtrlFlow() : nullptr;
+    if(!loop)
+    { return false; }
+    if(loop->cursor > 0) { scope->clear(); } // same as exitScope: each iteration starts with an empty scope
+    return loop->advance();
+}
+
+void EnvironmentManager::popScope()
+{
+    if(scopeCount <= 1) // the global scope stays
+    { return; }
+    Scope* scope = innermost();
+    dropTimer(scope->timerId);
+    scope->recycle();
+    scopeCount--;
+}
+
 std::shared_ptr<RuleNode> EnvironmentManager::exitScope(bool &shouldBlock, bool force)
 {
     shouldBlock = false;
-    if(scopes.empty()) // end of game
+    if(scopeCount == 0) // end of game
     { throw GameOverException(); return nullptr; }
 
-    Scope* toDelete = scopes.front().get();
+    Scope* toDelete = innermost();
     if(!toDelete) // error: should never happen
     { return nullptr; }
 
@@ -114,7 +287,7 @@ std::shared_ptr<RuleNode> EnvironmentManager::exitScope(bool &shouldBlock, bool
         }
         else if(!timer->hasFlag())
         {
-            timers.erase(toDelete->timerId);
+            dropTimer(toDelete->timerId);
         }
     }
     // check for waiting inputs
@@ -130,24 +303,41 @@ std::shared_ptr<RuleNode> EnvironmentManager::exitScope(bool &shouldBlock, bool
 
     if(!force && !deleteCtrlFlow->exiting)
     {
-        toDelete->variables.clear();
+        toDelete->clear();
         return deleteCtrlFlow->getNode(); // goto for statement
     }
 
     auto next = deleteCtrlFlow->getNode()->getNextNode();
-    scopes.pop_front(); // needs to be last so toDelete isnt deallocated
+    toDelete->recycle(); // needs to be last so the control flow isn't dropped early
+    scopeCount--;
     return next; // goto statement after for
 }
 
 std::shared_ptr<RuleNode> EnvironmentManager::updateTimers()
 {
-    // move all expired timers to vector
+    std::vector<int> expired;
+    for(const auto &[id, timer] : timers)
+    {
+        if(timer->isExpired()) { expired.push_back(id); }
+    }
+    return fireTimers(expired);
+}
+
+std::shared_ptr<RuleNode> EnvironmentManager::fireTimers(const std::vector<int> &timerIds)
+{
+    // move fired timers out first: exiting scopes below looks timers up
     std::vector<std::unique_ptr<Timer>> expiredTimers;
-    std::for_each(timers.begin(), timers.end(),
-        [&expiredTimers](auto &timer) { expiredTimers.emplace_back(std::move(timer.second)); });
-    std::erase_if(timers, [](auto &timer) { return timer.second == nullptr; });
+    for(int id : timerIds)
+    {
+        auto it = timers.find(id);
+        if(it == timers.end()) // already dropped with its scope
+        { continue; }
+        if(wheel) { wheel->cancel(it->second->wheelId); } // no-op if the wheel is what fired it
+        expiredTimers.emplace_back(std::move(it->second));
+        timers.erase(it);
+    }
 
-    unsigned int lastExitScopeId = scopes.size();
+    unsigned int lastExitScopeId = scopeCount;
     std::shared_ptr<RuleNode> nextRuleNode = nullptr;
     std::for_each(expiredTimers.begin(), expiredTimers.end(),
         [this, &lastExitScopeId, &nextRuleNode](const auto &timer)
@@ -160,7 +350,7 @@ std::shared_ptr<RuleNode> EnvironmentManager::updateTimers()
 
             // exit scopes up to one with timer
             int scopeId = timer->scopeid; // need to be signed since -1 is valid
-            while(scopeId < (int) scopes.size())
+            while(scopeId < (int) scopeCount)
             {
                 bool shouldBlock; // can ignore
                 exitScope(shouldBlock, true);
@@ -175,28 +365,327 @@ std::shared_ptr<RuleNode> EnvironmentManager::updateTimers()
     return nextRuleNode;
 }
 
+namespace
+{
+    // rule nodes in pre-order: node, its bodies, then the nodes after it
+    void indexRules(const std::shared_ptr<RuleNode> &first, std::vector<std::shared_ptr<RuleNode>> &nodes)
+    {
+        for(auto node = first; node; node = node->getNextNode())
+        {
+            nodes.push_back(node);
+            for(const auto &child : node->getBody())
+            { indexRules(child.child, nodes); }
+        }
+    }
+
+    // 0 for nullptr, else position + 1
+    uint64_t ruleIndex(const std::unordered_map<RuleNode*, uint64_t> &indices, const std::shared_ptr<RuleNode> &node)
+    {
+        if(!node)
+        { return 0; }
+        auto it = indices.find(node.get());
+        if(it == indices.end())
+        { throw BadVariableArgException("Rule node isn't part of the rule tree"); }
+        return it->second + 1;
+    }
+
+    std::shared_ptr<RuleNode> ruleAt(const std::vector<std::shared_ptr<RuleNode>> &nodes, uint64_t index)
+    {
+        if(index > nodes.size())
+        { throw BadVariableArgException("Snapshot doesn't match the rule tree"); }
+        return index == 0? nullptr : nodes[index - 1];
+    }
+}
+
+std::string EnvironmentManager::snapshot(const std::shared_ptr<RuleNode> &root) const
+{
+    std::vector<std::shared_ptr<RuleNode>> nodes;
+    indexRules(root, nodes);
+    std::unordered_map<RuleNode*, uint64_t> indices;
+    for(size_t i = 0; i < nodes.size(); i++)
+    { indices[nodes[i].get()] = i; }
+
+    Encoder encoder;
+    // outermost scope first so restore can push each one to the front
+    encoder.writeUInt(scopeCount);
+    for(size_t i = 0; i < scopeCount; i++)
+    {
+        Scope &scope = *scopes[i];
+        encoder.writeInt(scope.timerId);
+        encoder.write(scope.allVariables());
+
+        const ControlFlow* ctrlFlow = scope.getCtrlFlow();
+        encoder.writeUInt(ctrlFlow != nullptr);
+        if(ctrlFlow)
+        {
+            encoder.writeUInt(ruleIndex(indices, ctrlFlow->node));
+            encoder.write(ctrlFlow->range);
+            encoder.writeUInt(ctrlFlow->cursor);
+            encoder.writeUInt(ctrlFlow->exiting);
+        }
+    }
+
+    encoder.writeUInt(timers.size());
+    for(const auto &[id, timer] : timers)
+    {
+        encoder.writeInt(timer->id);
+        encoder.writeUInt(ruleIndex(indices, timer->nextRuleNode));
+        encoder.writeUInt(timer->duration.count());
+        encoder.writeUInt(timer->type);
+        encoder.writeString(timer->flagName);
+        encoder.writeInt(timer->scopeid);
+        encoder.writeInt(std::chrono::duration_cast<std::chrono::milliseconds>(timer->expireTime.time_since_epoch()).count());
+    }
+    return encoder.release();
+}
+
+void EnvironmentManager::restore(std::string_view data, const std::shared_ptr<RuleNode> &root)
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    std::vector<std::shared_ptr<RuleNode>> nodes;
+    indexRules(root, nodes);
+
+    // decode everything before touching the current state so bad data leaves it as it was
+    Decoder decoder(data);
+    std::vector<std::unique_ptr<Scope>> newScopes;
+    for(uint64_t i = decoder.readUInt(); i > 0; i--)
+    {
+        int timerId = decoder.readInt();
+        varType variables = decoder.read();
+        if(!std::holds_alternative<varMapType>(variables))
+        { throw BadVariableArgException("Snapshot has a bad scope"); }
+
+        std::unique_ptr<Scope> scope;
+        if(decoder.readUInt())
+        {
+            scope = std::make_unique<Scope>(ruleAt(nodes, decoder.readUInt()), this);
+            ControlFlow* ctrlFlow = scope->getCtrlFlow();
+            ctrlFlow->range = decoder.read();
+            ctrlFlow->cursor = decoder.readUInt();
+            ctrlFlow->exiting = decoder.readUInt();
+        }
+        else
+        { scope = std::make_unique<Scope>(this); }
+        if(newScopes.empty()) // global scope
+        { scope->setSlots(&globalNames); }
+        scope->timerId = timerId;
+        for(const auto &[name, value] : std::get<varMapType>(variables)) { scope->setVariable(name, value); }
+        newScopes.emplace_back(std::move(scope));
+    }
+
+    std::map<int, std::unique_ptr<Timer>> newTimers;
+    for(uint64_t i = decoder.readUInt(); i > 0; i--)
+    {
+        int id = decoder.readInt();
+        auto next = ruleAt(nodes, decoder.readUInt());
+        std::chrono::milliseconds duration(decoder.readUInt());
+        auto type = (Timer::Type) decoder.readUInt();
+        std::string flagName = decoder.readString();
+        auto timer = std::make_unique<Timer>(id, next, duration, type, flagName);
+        timer->scopeid = decoder.readInt();
+        timer->expireTime = std::chrono::system_clock::time_point(std::chrono::milliseconds(decoder.readInt()));
+        // same wall clock expiry, on this process' steady clock
+        timer->deadline = std::chrono::steady_clock::now() + (timer->expireTime - std::chrono::system_clock::now());
+        newTimers[id] = std::move(timer);
+    }
+
+    while(!timers.empty()) { dropTimer(timers.begin()->first); }
+    scopes = std::move(newScopes);
+    scopeCount = scopes.size();
+    timers = std::move(newTimers);
+    for(auto &[id, timer] : timers) { startTimer(*timer, true); }
+}
+
 Timer* EnvironmentManager::getTimer(int timerId) const
 {
     auto it = timers.find(timerId);
     return it == timers.end()? nullptr : (it->second).get();
 }
 
-std::shared_ptr<Variable> EnvironmentManager::getVariable(std::string_view name) const
+std::shared_ptr<Variable> EnvironmentManager::getVariable(Symbol name) const
 {
     auto scope = hasVar(name);
     return (scope != nullptr)? scope->getVariable(name) : nullptr;
 }
 
-Scope* EnvironmentManager::hasVar(std::string_view name) const
+std::shared_ptr<Variable> EnvironmentManager::getVariable(std::string_view name) const
+{
+    auto symbol = Symbol::find(name);
+    return symbol? getVariable(*symbol) : nullptr;
+}
+
+Variable* EnvironmentManager::borrowVariable(std::string_view name) const
+{
+    // a name that was never interned can't be in any scope
+    auto symbol = Symbol::find(name);
+    if(!symbol)
+    { return nullptr; }
+
+    for(size_t i = scopeCount; i-- > 0;)
+    {
+        if(auto var = scopes[i]->borrowVariable(*symbol))
+        { return var; }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<Variable>* EnvironmentManager::findSlot(Symbol name, SlotRef slot) const
+{
+    if(!slot.resolved() || slot.depth >= scopeCount)
+    { return nullptr; }
+    return scopes[slot.depth]->findSlot(name, slot.index);
+}
+
+std::shared_ptr<Variable> EnvironmentManager::getVariable(Symbol name, SlotRef slot) const
+{
+    auto var = findSlot(name, slot);
+    return (var && *var)? *var : getVariable(name);
+}
+
+Variable* EnvironmentManager::borrowVariable(Symbol name, SlotRef slot) const
+{
+    auto var = findSlot(name, slot);
+    return (var && *var)? var->get() : borrowVariable(name.str());
+}
+
+namespace
+{
+    using scopeChain = std::vector<const std::vector<Symbol>*>; // slot names of each scope, global scope first
+
+    // dotted names (players.name) resolve to their first part
+    SlotRef lookupSlot(const scopeChain &chain, Symbol token)
+    {
+        auto dot = token.str().find('.');
+        Symbol name = dot == std::string_view::npos? token : Symbol(token.str().substr(0, dot));
+        for(size_t depth = chain.size(); depth-- > 0;)
+        {
+            const auto &names = *chain[depth];
+            auto it = std::find(names.begin(), names.end(), name);
+            if(it != names.end())
+            { return {(uint16_t) depth, (uint16_t) (it - names.begin())}; }
+        }
+        return {};
+    }
+
+    // every control flow node opens one scope when entered, so a body's names live one level further in.
+    // the node's own tokens (e.g. a loop's range) are evaluated before its scope exists
+    void resolveRules(const std::shared_ptr<RuleNode> &first, scopeChain &chain)
+    {
+        for(auto node = first; node; node = node->getNextNode())
+        {
+            const auto &symbols = node->getSymbols();
+            auto nodeType = node->getType();
+            std::vector<Symbol> scopeNames;
+            if((nodeType == NodeType::FOR || nodeType == NodeType::PARALLEL) && symbols.size() > 2 && !symbols[1].empty())
+            { scopeNames.push_back(symbols[1][0]); }
+            node->setScopeNames(std::move(scopeNames));
+
+            std::vector<std::vector<SlotRef>> slots;
+            for(const auto &expression : symbols)
+            {
+                auto &row = slots.emplace_back();
+                for(Symbol token : expression) { row.push_back(lookupSlot(chain, token)); }
+            }
+
+            if(node->isControlFlow())
+            {
+                if(chain.size() >= SlotRef::none)
+                { throw BadVariableArgException("Rules are nested too deeply"); }
+                chain.push_back(&node->getScopeNames());
+                if(!node->getScopeNames().empty())
+                { slots[1][0] = {(uint16_t) (chain.size() - 1), 0}; }
+                for(const auto &child : node->getBody())
+                { resolveRules(child.child, chain); }
+                chain.pop_back();
+            }
+
+            // compiled once here instead of walking the tokens every time a rule runs. guards are evaluated with
+            // the node's own tokens, before its scope is opened
+            auto lookup = [&chain](Symbol name) { return lookupSlot(chain, name); };
+            auto compile = [&lookup](const std::vector<std::string> &tokens, const std::vector<SlotRef> &slots)
+                -> std::shared_ptr<const Expression>
+            {
+                try { return std::make_shared<const Expression>(Expression::compile(tokens, slots, lookup)); }
+                catch(const BadVariableArgException &) { return nullptr; }
+            };
+            std::vector<std::shared_ptr<const Expression>> expressions;
+            const auto &data = node->getData();
+            for(size_t i = 0; i < data.size(); i++) { expressions.push_back(compile(data[i], slots[i])); }
+            std::vector<std::shared_ptr<const Expression>> guards;
+            for(const auto &child : node->getBody()) { guards.push_back(compile(child.key, {})); }
+            node->setExpressions(std::move(expressions));
+            node->setGuards(std::move(guards));
+            node->setSlots(std::move(slots));
+        }
+    }
+}
+
+void EnvironmentManager::setGlobals(const std::vector<Symbol> &globals)
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    globalNames = globals;
+    if(scopeCount != 0) { scopes.front()->setSlots(&globalNames); }
+}
+
+void EnvironmentManager::resolve(const std::shared_ptr<RuleNode> &root, const std::vector<Symbol> &globals)
+{
+    MemoryResourceGuard guard(getMemoryResource());
+    setGlobals(globals);
+    scopeChain chain = {&globalNames};
+    resolveRules(root, chain);
+}
+
+bool EnvironmentManager::isCurrent(const std::vector<Dependency> &inputs) const
 {
-    auto scopeIt = std::find_if(scopes.begin(), scopes.end(),
-        [&name](const auto &scope) { return scope->hasVar(name); });
+    for(const auto &input : inputs)
+    {
+        if(input.byName && borrowVariable(input.name, input.slot) != input.var.get())
+        { return false; }
+        if(input.var && input.var->version() != input.version)
+        { return false; }
+    }
+    return true;
+}
 
-    return (scopeIt == scopes.end())? nullptr : (*scopeIt).get();
+const varType& EnvironmentManager::evaluateCached(const Expression &expression)
+{
+    auto [it, added] = memos.try_emplace(expression.getId());
+    Memo &memo = it->second;
+    if(!added && isCurrent(memo.inputs))
+    { return memo.value; }
+
+    memo.inputs.clear(); // keeps its capacity for the next time round
+    try
+    { expression.evaluate(*this, [&memo](const varType &value, bool) { memo.value = value; }, &memo.inputs); }
+    catch(...)
+    {
+        memos.erase(it);
+        throw;
+    }
+    return memo.value;
 }
 
-int EnvironmentManager::depth() const { return scopes.size(); }
-bool EnvironmentManager::inParallel() const { return scopes.front()->isParallel; }
+void EnvironmentManager::clearCache() { memos.clear(); }
+
+Scope* EnvironmentManager::hasVar(Symbol name) const
+{
+    // innermost first
+    for(size_t i = scopeCount; i-- > 0;)
+    {
+        if(scopes[i]->hasVar(name))
+        { return scopes[i].get(); }
+    }
+    return nullptr;
+}
+
+Scope* EnvironmentManager::hasVar(std::string_view name) const
+{
+    auto symbol = Symbol::find(name);
+    return symbol? hasVar(*symbol) : nullptr;
+}
+
+int EnvironmentManager::depth() const { return scopeCount; }
+bool EnvironmentManager::inParallel() const { return innermost()->isParallel; }
 
 
 // ==========================================ControlFlow===========================================
@@ -206,18 +695,21 @@ ControlFlow::ControlFlow(const std::shared_ptr<RuleNode> &anode, EnvironmentMana
     if(!node)
     { return; }
 
-    std::vector<std::vector<std::string>> data = node->getData();
-    if(data.size() < 2) // loops need minimum of variable name + range
+    // names were interned when the rule was parsed
+    const std::vector<std::vector<Symbol>> &data = node->getSymbols();
+    if(data.size() < 3) // loops need minimum of variable name + range
     { return; }
 
-    std::vector<std::string> element = data.at(1);
-    std::vector<std::string> list = data.at(2);
+    const std::vector<Symbol> &element = data.at(1);
+    const std::vector<Symbol> &list = data.at(2);
 
     loopVarName = element.at(0);
-    auto var = mgr->getVariable(list.at(1));
-    if(std::get_if<listObj>(&var->getRef()))
+    const auto &slots = node->getSlots(); // empty if the rules weren't resolved
+    loopVarSlot = slots.empty()? SlotRef() : slots.at(1).at(0);
+    auto var = mgr->getVariable(list.at(1), slots.empty()? SlotRef() : slots.at(2).at(1));
+    if(var && ListObjUtils::isList(var->getRef()))
     {
-        range = var->getPtr();
+        range = var->get();
     }
 }
 
@@ -229,8 +721,14 @@ std::shared_ptr<RuleNode> ControlFlow::getNext()
     auto nodeType = node->getType();
     if(nodeType == NodeType::FOR || nodeType == NodeType::PARALLEL)
     {
-        auto childNode = node->getChildWithKey({"true"});
-        return childNode.child;
+        // looked up without getChildWithKey so a loop iteration doesn't copy keys
+        static const std::vector<std::string> loopBody = {"true"};
+        for(const auto &child : node->getBody())
+        {
+            if(child.key == loopBody)
+            { return child.child; }
+        }
+        return nullptr;
     }
     else // [TODO] everything thats not a for or parallel
     {
@@ -242,139 +740,19 @@ std::shared_ptr<RuleNode> ControlFlow::getNode() const { return node; }
 
 std::shared_ptr<RuleNode> ControlFlow::updateLoop()
 {
-    if(VariableUtils::size(*range) != 0)
-    {
-        std::shared_ptr<Variable> newVar = ListObjUtils::get_at(*range, varType(0));
-        mgr->setVariable(loopVarName, newVar->getRef());
-        ListObjUtils::remove_at(*range, varType(0));
-
-        exiting = VariableUtils::size(*range) == 0;
-    }
+    advance();
     return getNext();
 }
 
-varType EnvironmentManager::parseValue(std::string_view expression, Scope* scope){
-    if (expression == "true")
-    {
-        return true;
-    } else if (expression == "false")
-    {
-        return false;
-    } else if(expression[0] == '\"'){
-        
-        
-        auto first = expression.find("{");
-        auto second = expression.find("}");
-        auto variable = expression.substr(first, second - first);
-       
-        if(variable.size() != 0){
-            auto stringVariable = scope->getVariable(variable).get()->get();
-
-            std::string stringVar = std::get<std::string>(stringVariable);
-
-            std::string firstPart = (std::string)expression.substr(0, expression.find("{"));
-            std::string secondPart = (std::string)expression.substr(second, expression.length() - second);
-            return firstPart + stringVar + secondPart;
-        }
-
-        return (std::string)expression;
-    } else if (expression[0] >= 48 && expression[0] <= 57) { // ascii values for integers
-        try
-        {
-            return std::stoi((std::string)expression);
-        }
-        catch(const std::exception& e)
-        {
-            return (std::string)expression;
-        } 
-    }
-    return (std::string)expression;
-}
-
-varType EnvironmentManager::evaluateOperator(
-    std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, 
-    Scope* scope, const std::map<std::string, operatorTypes>::iterator operatorIt){
-    switch(operatorIt->second)
-    {
-        case EQUALS:
-            expression += 1;
-            return evaluationExpression(expression, end, scope) == evaluationExpression(expression, end, scope);
-            break;
-        case NEGATION:
-            expression += 1;
-            return !std::get<bool>(evaluationExpression(expression, end, scope));
-            break;
-        case ADDITION:
-            expression += 1;
-            return std::get<int>(evaluationExpression(expression, end, scope)) + std::get<int>(evaluationExpression(expression, end, scope));
-            break;
-        case OR:
-            expression += 1;
-            return std::get<bool>(evaluationExpression(expression, end, scope)) || std::get<bool>(evaluationExpression(expression, end, scope));
-            break;
-    }
-    return 0; // should never get here
-}
-
-varType EnvironmentManager::evaluateBuildIn(
-    std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, 
-    Scope* scope, const std::map<std::string, builtinTypes>::iterator it){
-    switch (it->second)
-    {
-        case SIZETYPE:
-        {
-            varType size((int)scope->getVariable(*expression)->size());
-            expression += 2;
-            return size;
-            break;
-        }
-        case CONTAINS:
-        {
-            //varType contains(var::ListObjUtils::contains(scope->getVariable(*expression), scope->getVariable(*(expression + 2))));
-            expression += 3;
-            return true;//contains;
-            break;
-        }
-        case COLLECT:
-        {
-            //auto collect = var::ListObjUtils::collect(scope->getVariable(*expression), scope->getVariable(*(expression + 2)), scope->getVariable(*(expression + 3)) == scope->getVariable(*(expression + 4)));
-            expression += 5;
-            return false;
-            break;
-        }
-        case UPFROM:
-        {
-            //auto upfrom = var::ListObjUtils::upfrom(scope->getVariable(*expression), scope->getVariable(*(expression + 2)));
-            expression += 3;
-            return false;
-            break;
-        }
-    }
-    return false; // should never get here
-}
-
-varType EnvironmentManager::evaluationExpression(std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, Scope* scope){
-    // expression should never be at end, so only check if next item is end, if so, skip checking for multi part expresion
-    if(expression + 1 != end){
-        const auto it = buildtinMap.find(*(expression + 1));
-        if(it != buildtinMap.end()){
-            return evaluateBuildIn(expression, end, scope, it);
-        } 
-            
-        const auto operatorIt = operatorMap.find(*expression);
-        if(operatorIt != operatorMap.end()){
-            return evaluateOperator(expression, end, scope, operatorIt);
-        }
-    }
-    
-    if(hasVar(*expression)->hasVar(*expression)){
-        auto var = scope->getVariable(*expression);
-        expression++;
-        return (*var.get()).get();
-    } else{
-        auto var = parseValue(*expression, scope);
-        expression++;
-        return var;
-    }
-    
+bool ControlFlow::advance()
+{
+    size_t size = VariableUtils::size(range);
+    if(cursor >= size)
+    { return false; }
+
+    std::shared_ptr<Variable> newVar = ListObjUtils::get_at(range, varType((int)cursor));
+    mgr->setVariable(loopVarName, loopVarSlot, newVar->getRef());
+    cursor++;
+    exiting = cursor >= size;
+    return true;
 }
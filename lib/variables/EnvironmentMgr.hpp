@@ -1,11 +1,15 @@
 #ifndef ENV_MGR_H
 #define ENV_MGR_H
 #include "Variables.hpp"
+#include "Serializer.hpp"
 #include "RuleInterpreter.h"
-#include <deque>
+#include "TimerWheel.hpp"
+#include "Expression.hpp"
+#include <map>
+#include <optional>
 #include <chrono>
-#include <time.h>
 #include <string>
+#include <unordered_map>
 
 
 using namespace var;
@@ -26,7 +30,9 @@ namespace env_mgr
 
             Timer();
             Timer(const Timer &other);
-            Timer(int anId, const std::shared_ptr<RuleNode> &next, int aduration,
+            Timer(int anId, const std::shared_ptr<RuleNode> &next, int aduration, // seconds
+                  Type aType=Type::REGUALR, std::string aflagName="");
+            Timer(int anId, const std::shared_ptr<RuleNode> &next, std::chrono::milliseconds aduration,
                   Type aType=Type::REGUALR, std::string aflagName="");
             ~Timer() = default;
 
@@ -42,8 +48,12 @@ namespace env_mgr
             std::string flagName = "";
 
         private:
-            unsigned int duration = 0;
-            time_t expireTime;
+            friend class EnvironmentManager; // snapshot/restore
+            std::chrono::milliseconds duration{0};
+            std::chrono::steady_clock::time_point deadline; // unaffected by wall clock changes
+            // the same moment as wall clock time, for snapshots (steady clock times mean nothing in another process)
+            std::chrono::system_clock::time_point expireTime;
+            TimerWheel::TimerId wheelId = 0;
     };
 
     class EnvironmentManager;
@@ -58,59 +68,105 @@ namespace env_mgr
             std::shared_ptr<RuleNode> getNext();
             std::shared_ptr<RuleNode> getNode() const;
             std::shared_ptr<RuleNode> updateLoop(); // update loop variable. returns next node to goto
+            bool advance(); // next element into the loop variable, false if there are none left
 
             bool exiting = true;
 
         private:
+            friend class EnvironmentManager; // snapshot/restore
             const std::shared_ptr<RuleNode> node;
-            std::string loopVarName;
-            std::shared_ptr<varType> range;
+            Symbol loopVarName;
+            SlotRef loopVarSlot;
+            // snapshot of the list when the loop started (copy on write so O(1)). the source list is left intact
+            // and changes to it during the loop don't affect iteration
+            varType range = listObj();
+            size_t cursor = 0; // index of the next element
             EnvironmentManager* mgr;
     };
     class Scope
     {
         public:
             Scope(EnvironmentManager* mgr) { }
-            Scope(const std::shared_ptr<RuleNode> &node, EnvironmentManager* mgr):
-                isParallel(node? node->getType() == NodeType::PARALLEL : false),
-                ctrlFlow(std::make_unique<ControlFlow>(node, mgr)) { }
+            Scope(const std::shared_ptr<RuleNode> &node, EnvironmentManager* mgr) { reset(node, mgr); }
             Scope(const Scope& other) = delete;
             ~Scope() = default;
 
+            // names are Symbols so lookups compare ints
             template <typename T>
-            void setVariable(std::string_view name, const T &value);
-            void setVariable(std::string_view name, const std::shared_ptr<Variable> &value);
+            void setVariable(Symbol name, const T &value);
+            void setVariable(Symbol name, const std::shared_ptr<Variable> &value);
 
-            std::shared_ptr<Variable> getVariable(std::string_view name) const;
+            std::shared_ptr<Variable> getVariable(Symbol name) const;
+            Variable* borrowVariable(Symbol name) const; // no ref count change. nullptr if missing
             ControlFlow* getCtrlFlow();
 
-            std::map<std::string, std::shared_ptr<Variable>>::iterator begin() { return variables.begin(); }
-            std::map<std::string, std::shared_ptr<Variable>>::iterator end() { return variables.end(); }
+            varMapType::iterator begin() { return variables.begin(); }
+            varMapType::iterator end() { return variables.end(); }
 
-            bool hasVar(std::string_view name) const;
+            bool hasVar(Symbol name) const;
             bool waitingInputs() const { return false; } // [TODO]
 
-            std::map<std::string, std::shared_ptr<Variable>> variables;
-            const bool isParallel = false;
+            // names get a slot each, in order. variables already set under those names move into their slot.
+            // names has to outlive the scope (it belongs to the rule node or the manager)
+            void setSlots(const std::vector<Symbol>* names);
+            int slotOf(Symbol name) const; // -1 if name has no slot here
+            // the slot at index if it belongs to name, else nullptr. no hashing
+            std::shared_ptr<Variable>* findSlot(Symbol name, uint16_t index);
+            varMapType allVariables() const; // slots (set ones) then by name variables
+            void clear(); // empties slots and variables
+
+            // frames are reused by EnvironmentManager: reset() makes this a fresh scope for node, recycle() drops
+            // everything it holds. neither frees the variable/slot storage, so the next scope doesn't allocate
+            void reset(const std::shared_ptr<RuleNode> &node, EnvironmentManager* mgr);
+            void recycle();
+
+            varMapType variables; // names without a slot
+            bool isParallel = false;
             int timerId = -1;
         private:
-            const std::unique_ptr<ControlFlow> ctrlFlow = nullptr;
+            std::optional<ControlFlow> ctrlFlow; // inline so recycling a frame doesn't touch the heap
+            const std::vector<Symbol>* slotNames = nullptr;
+            std::vector<std::shared_ptr<Variable>, GameAllocator<std::shared_ptr<Variable>>> slots;
     };
 
     class EnvironmentManager
     {
         public:
-            EnvironmentManager();
+            // all Variables/scopes made by this manager are allocated from memory (heap if nullptr).
+            // memory is kept alive until every scope has been destroyed
+            EnvironmentManager(std::shared_ptr<std::pmr::memory_resource> memory=nullptr);
             EnvironmentManager(const EnvironmentManager&) = delete;
-            ~EnvironmentManager() = default;
+            ~EnvironmentManager(); // cancels its timers in the wheel
 
             template <typename T>
-            void setVariable(std::string_view name, const T &value);
+            void setVariable(Symbol name, const T &value);
+            template <typename T>
+            void setVariable(std::string_view name, const T &value) { setVariable(Symbol(name), value); }
 
+            std::shared_ptr<Variable> getVariable(Symbol name) const;
+            // by name: a name that was never interned isn't in any scope, so these don't intern it
             std::shared_ptr<Variable> getVariable(std::string_view name) const;
+            // allocation free lookup: name is not interned and no ref counts change.
+            // only valid while the variable stays in scope
+            Variable* borrowVariable(std::string_view name) const;
 
+            Scope* hasVar(Symbol name) const;
             Scope* hasVar(std::string_view name) const;
 
+            // resolver pass, run once after parsing: gives each name in globals a slot in the global scope and
+            // each loop variable a slot in its loop's scope, then records on every rule node where its tokens live
+            // (RuleNode::getSlots()). names that resolve to nothing stay name based
+            void resolve(const std::shared_ptr<RuleNode> &root, const std::vector<Symbol> &globals = {});
+            // only the global slots: for a manager running rules that were resolve()d (with the same globals) elsewhere
+            void setGlobals(const std::vector<Symbol> &globals);
+
+            // O(1) lookups through a slot from resolve(). fall back to the name if slot is unresolved, or the
+            // scope at that depth doesn't hold it (e.g. a timer scope in between) or it hasn't been set yet
+            template <typename T>
+            void setVariable(Symbol name, SlotRef slot, const T &value);
+            std::shared_ptr<Variable> getVariable(Symbol name, SlotRef slot) const;
+            Variable* borrowVariable(Symbol name, SlotRef slot) const;
+
             void enterScope(const std::shared_ptr<RuleNode> &node, const Timer &timer);
 
             // enterScope and exitScope return next node to goto
@@ -119,70 +175,95 @@ namespace env_mgr
             // shouldBlock set to true if should block
             std::shared_ptr<RuleNode> exitScope(bool &shouldBlock, bool force=false);
 
+            // scopes for RuleExecutor, which keeps its own position in the rules instead of following rule nodes:
+            // pushScope opens node's scope (a loop takes its range), nextElement moves the innermost loop on
+            // (false once it has gone through its range) and popScope closes the innermost scope
+            void pushScope(const std::shared_ptr<RuleNode> &node);
+            bool nextElement();
+            void popScope();
+
             int depth() const; // number of scopes
             bool inParallel() const;
-
-            // [TODO]
-            std::shared_ptr<Variable> evaluateExpression(std::string_view expr) const { return makeVarPtr("true"); }
-
-            std::shared_ptr<RuleNode> updateTimers(); // returns next node if need to jump, else nullptr
+            // back to just an empty global scope, e.g. to reuse the manager for another game.
+            // scope frames (and their capacity) are kept
+            void reset();
+
+            // memoized evaluate: the last result of expression is reused while every Variable it was computed from
+            // has the same version (Variable::version()) and every name it looked up still finds the same Variable.
+            // the result is valid until expression is evaluated again or the cache is cleared
+            const varType& evaluateCached(const Expression &expression);
+            void clearCache(); // reset() does too
+
+            // timers go to wheel (tagged with owner) as well, so whoever advances the wheel can tell this manager
+            // which of its timers fired with fireTimers() instead of it polling them. nullptr to stop
+            void setTimerWheel(std::shared_ptr<TimerWheel> wheel, int owner);
+            // both return next node if need to jump, else nullptr.
+            std::shared_ptr<RuleNode> updateTimers(); // checks every timer for expiry
+            std::shared_ptr<RuleNode> fireTimers(const std::vector<int> &timerIds); // ids that aren't timers are ignored
             Timer* getTimer(int timerId) const; // should never be used, for testing only
+            std::pmr::memory_resource* getMemoryResource() const;
 
-            enum builtinTypes{
-                SIZETYPE,
-                CONTAINS,
-                COLLECT,
-                UPFROM
-            };
+            // binary checkpoint of every scope (variables, loop positions) and timer, see Serializer.hpp.
+            // rule nodes are saved as their position in the tree under root, so restore() needs the same rules.
+            // restore() replaces the current state, timers keep their original expiry time
+            std::string snapshot(const std::shared_ptr<RuleNode> &root) const;
+            void restore(std::string_view data, const std::shared_ptr<RuleNode> &root);
 
-            enum operatorTypes{
-                EQUALS,
-                NEGATION,
-                ADDITION,
-                OR
-            };
-            
-            varType evaluationExpression(std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, env_mgr::Scope* scope);
-            varType evaluateOperator(std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, Scope* scope, const std::map<std::string, operatorTypes>::iterator operatorIt);
-            varType evaluateBuildIn(std::vector<std::string>::iterator& expression, std::vector<std::string>::iterator& end, Scope* scope, const std::map<std::string, builtinTypes>::iterator it);
-            varType parseValue(std::string_view expression, Scope* scope);
-        
         protected:
-            std::deque<std::unique_ptr<Scope>> scopes;
+            const std::shared_ptr<std::pmr::memory_resource> memory; // declared first so it is released last
+            // scope stack, global scope first. only the first scopeCount frames are live, the rest have been
+            // recycled and are reused by the next enterScope, so loops don't allocate a scope per iteration
+            std::vector<std::unique_ptr<Scope>> scopes;
+            size_t scopeCount = 0;
             std::map<int, std::unique_ptr<Timer>> timers;
-        private:
-            std::map<std::string, enum builtinTypes> buildtinMap {
-                {"size", SIZETYPE},
-                {"contains", CONTAINS},
-                {"collect", COLLECT},
-                {"upfrom", UPFROM}
-            };
-
-            std::map<std::string, enum operatorTypes> operatorMap {
-                {"=", EQUALS},
-                {"!", NEGATION},
-                {"+", ADDITION},
-                {"|", OR}
+            std::vector<Symbol> globalNames; // slot names of the global scope
+            std::shared_ptr<TimerWheel> wheel;
+            int wheelOwner = 0;
+            struct Memo
+            {
+                std::vector<Dependency> inputs;
+                varType value;
             };
+            std::unordered_map<uint64_t, Memo> memos; // by Expression::getId()
+        private:
+            friend class Expression; // reads the innermost scope
+            void startTimer(Timer &timer, bool resume=false); // resume: keep the deadline from a snapshot
+            void dropTimer(int timerId);
+            std::shared_ptr<Variable>* findSlot(Symbol name, SlotRef slot) const;
+            Scope& nextFrame(const std::shared_ptr<RuleNode> &node); // reset, not pushed yet
+            Scope* innermost() const;
+            bool isCurrent(const std::vector<Dependency> &inputs) const;
     };
 
 
     // template function definitions
     template <typename T>
-    void Scope::setVariable(std::string_view name, const T &value)
-    { setVariable(name, std::make_shared<Variable>(value)); }
+    void Scope::setVariable(Symbol name, const T &value)
+    { setVariable(name, allocateVar(variables.get_allocator(), value)); }
 
     template <typename T>
-    void EnvironmentManager::setVariable(std::string_view name, const T &value)
+    void EnvironmentManager::setVariable(Symbol name, const T &value)
     {
-        if(scopes.empty()) { return; }
+        if(scopeCount == 0) { return; }
+        MemoryResourceGuard guard(getMemoryResource());
 
         // check if variable already in a scope -> reset if so, else create new
         auto scope = hasVar(name);
-        auto addToScope = (scope == nullptr)? scopes.front().get() : scope;
+        auto addToScope = (scope == nullptr)? innermost() : scope;
         addToScope->setVariable(name, value);
     }
 
+    template <typename T>
+    void EnvironmentManager::setVariable(Symbol name, SlotRef slot, const T &value)
+    {
+        auto var = findSlot(name, slot);
+        if(var == nullptr) { return setVariable(name, value); }
+
+        MemoryResourceGuard guard(getMemoryResource());
+        if constexpr (std::is_same_v<T, std::shared_ptr<Variable>>) { *var = value; }
+        else { *var = allocateVar({}, value); }
+    }
+
 };
 
 #endif
@@ -0,0 +1,529 @@
+#include "Expression.hpp"
+#include "StringTemplate.hpp"
+#include "EnvironmentMgr.hpp"
+#include <algorithm>
+#include <charconv>
+#include <optional>
+
+
+using namespace env_mgr;
+
+
+namespace env_mgr
+{
+    // recursive descent over the prefix token stream, emitting code in evaluation order
+    class ExpressionCompiler
+    {
+        public:
+            ExpressionCompiler(const std::vector<std::string> &someTokens, const std::vector<SlotRef> &someSlots,
+                const Expression::SlotLookup &aLookup, Expression &anOut):
+                tokens(someTokens), slots(someSlots), lookup(aLookup), out(anOut) {}
+
+            void compile()
+            {
+                expression();
+                if(pos != tokens.size())
+                { throw BadVariableArgException("Unexpected '" + tokens[pos] + "' after expression"); }
+            }
+        private:
+            enum class Builtin { NONE, SIZE, CONTAINS, COLLECT, UPFROM };
+
+            static Builtin builtinOf(std::string_view token)
+            {
+                if(token == "size") { return Builtin::SIZE; }
+                if(token == "contains") { return Builtin::CONTAINS; }
+                if(token == "collect") { return Builtin::COLLECT; }
+                if(token == "upfrom") { return Builtin::UPFROM; }
+                return Builtin::NONE;
+            }
+
+            uint32_t emit(Expression::Op op, uint32_t arg = 0)
+            {
+                out.instructions.push_back({op, arg});
+                return out.instructions.size() - 1;
+            }
+            void patch(uint32_t at) { out.instructions[at].arg = out.instructions.size(); }
+
+            uint32_t constant(varType value)
+            {
+                out.constants.push_back(std::move(value));
+                return out.constants.size() - 1;
+            }
+
+            const std::string& next()
+            {
+                if(pos >= tokens.size())
+                { throw BadVariableArgException("Expression ended early"); }
+                return tokens[pos++];
+            }
+
+            // literals are parsed here, once: true/false, quoted strings (kept quoted), ints, else a name
+            void operand()
+            {
+                size_t index = pos;
+                const std::string &token = next();
+                if(token == "true" || token == "false")
+                { emit(Expression::Op::CONST, constant(token == "true")); }
+                else if(!token.empty() && token[0] == '\"')
+                {
+                    auto text = StringTemplate::compile(token, lookup);
+                    if(text.placeholders() == 0)
+                    { emit(Expression::Op::CONST, constant(token)); }
+                    else
+                    {
+                        out.templates.push_back(std::make_shared<const StringTemplate>(std::move(text)));
+                        emit(Expression::Op::TEMPLATE, out.templates.size() - 1);
+                    }
+                }
+                else if(!token.empty() && token[0] >= '0' && token[0] <= '9')
+                {
+                    int value = 0;
+                    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+                    emit(Expression::Op::CONST, result.ec == std::errc()? constant(value) : constant(token));
+                }
+                else { load(token, index < slots.size()? slots[index] : std::optional<SlotRef>()); }
+            }
+
+            void load(std::string_view token, std::optional<SlotRef> slot)
+            {
+                Expression::Name name;
+                name.whole = Symbol(token);
+                name.fallback = constant(std::string(token));
+                auto dot = token.find('.');
+                name.root = Symbol(token.substr(0, dot));
+                name.slot = slot? *slot : lookup? lookup(name.root) : SlotRef();
+                while(dot != std::string_view::npos)
+                {
+                    token.remove_prefix(dot + 1);
+                    dot = token.find('.');
+                    name.path.emplace_back(token.substr(0, dot));
+                }
+
+                // a collect's binder hides variables of the same name
+                auto binder = std::find(binders.rbegin(), binders.rend(), name.root);
+                bool local = binder != binders.rend();
+                if(local) { name.local = binders.rend() - binder - 1; }
+
+                out.names.push_back(std::move(name));
+                emit(local? Expression::Op::LOAD_LOCAL : Expression::Op::LOAD, out.names.size() - 1);
+            }
+
+            void expression()
+            {
+                if(pos >= tokens.size())
+                { throw BadVariableArgException("Expression ended early"); }
+
+                if(pos + 1 < tokens.size())
+                {
+                    auto builtin = builtinOf(tokens[pos + 1]);
+                    if(builtin != Builtin::NONE)
+                    {
+                        operand();
+                        pos++;
+                        return call(builtin);
+                    }
+                }
+
+                const std::string &token = tokens[pos];
+                if(token.size() == 1 && std::string_view("=!+|&").find(token[0]) != std::string_view::npos && pos + 1 < tokens.size())
+                {
+                    pos++;
+                    return apply(token[0]);
+                }
+                operand();
+            }
+
+            void call(Builtin builtin)
+            {
+                switch(builtin)
+                {
+                    case Builtin::SIZE:
+                        emit(Expression::Op::SIZE);
+                        break;
+                    case Builtin::CONTAINS:
+                        expression();
+                        emit(Expression::Op::CONTAINS);
+                        break;
+                    case Builtin::UPFROM:
+                        expression();
+                        emit(Expression::Op::UPFROM);
+                        break;
+                    case Builtin::COLLECT:
+                    {
+                        Symbol binder(next());
+                        emit(Expression::Op::COLLECT);
+                        uint32_t loop = emit(Expression::Op::NEXT);
+                        binders.push_back(binder);
+                        expression();
+                        binders.pop_back();
+                        emit(Expression::Op::KEEP, loop);
+                        patch(loop);
+                        break;
+                    }
+                    case Builtin::NONE:
+                        break;
+                }
+            }
+
+            void apply(char op)
+            {
+                switch(op)
+                {
+                    case '!':
+                        expression();
+                        emit(Expression::Op::NOT);
+                        break;
+                    case '=':
+                    case '+':
+                        expression();
+                        expression();
+                        emit(op == '='? Expression::Op::EQUALS : Expression::Op::ADD);
+                        break;
+                    case '|':
+                    case '&':
+                    {
+                        expression();
+                        uint32_t jump = emit(op == '|'? Expression::Op::JUMP_IF_TRUE : Expression::Op::JUMP_IF_FALSE);
+                        expression();
+                        emit(Expression::Op::TEST_BOOL);
+                        patch(jump);
+                        break;
+                    }
+                }
+            }
+
+            const std::vector<std::string> &tokens;
+            const std::vector<SlotRef> &slots;
+            const Expression::SlotLookup &lookup;
+            Expression &out;
+            size_t pos = 0;
+            std::vector<Symbol> binders; // of the collects being compiled, outermost first
+    };
+};
+
+Expression Expression::compile(const std::vector<std::string> &tokens, const std::vector<SlotRef> &slots,
+                               const SlotLookup &lookup)
+{
+    Expression expression;
+    expression.id = nextVersion();
+    ExpressionCompiler(tokens, slots, lookup, expression).compile();
+    return expression;
+}
+
+namespace
+{
+    // stack entries borrow variables (nothing is copied to read a value) and only own what an op computed
+    struct Value
+    {
+        const varType* borrowed = nullptr;
+        varType owned;
+        bool missing = false; // a name that isn't set (or a key that isn't in its map)
+
+        const varType& get() const { return borrowed? *borrowed : owned; }
+        varType take() { return borrowed? *borrowed : std::move(owned); }
+    };
+
+    struct Loop
+    {
+        varType list;
+        size_t size;
+        size_t index = 0;
+        std::shared_ptr<Variable> current;
+        listObj result;
+    };
+
+    // shared by every evaluate() on this thread so evaluating doesn't allocate once they've grown
+    thread_local std::vector<Value> stack;
+    thread_local std::vector<Loop> loops;
+    thread_local std::string buffer; // templates render into this
+    thread_local std::vector<Dependency>* tracking = nullptr; // where reads are recorded, if anywhere
+
+    void track(std::shared_ptr<Variable> var)
+    {
+        if(tracking && var)
+        {
+            uint64_t version = var->version();
+            tracking->push_back({std::move(var), version, Symbol(), SlotRef(), false});
+        }
+    }
+
+    bool toBool(const varType &value)
+    {
+        auto result = std::get_if<bool>(&value);
+        if(result == nullptr)
+        { throw BadVariableArgException("Expected bool"); }
+        return *result;
+    }
+
+    // key of every element of a list, e.g. players.name. when the values are all ints or all strings the result is an
+    // intList/stringList, so contains() on it uses the typed list's index. otherwise it's a listObj, map elements give
+    // their Variable (shared, not copied)
+    varType eachWithKey(const listObj &list, Symbol key)
+    {
+        std::optional<Type> common;
+        for(const auto &item : list)
+        {
+            const varType &value = item->getRef();
+            track(item);
+            Type type;
+            if(std::holds_alternative<varMapType>(value))
+            {
+                auto var = VariableUtils::getVarWithKey(value, key);
+                track(var);
+                type = var? VariableUtils::getType(var->getRef()) : Type::NONE;
+            }
+            else if(std::holds_alternative<mapType>(value)) { type = Type::STRING; }
+            else
+            { throw BadVariableArgException("No '" + std::string(key.str()) + "' in a list element that isn't a map"); }
+            if(common && *common != type) { type = Type::NONE; }
+            common = type;
+        }
+
+        if(common == Type::INT)
+        {
+            intList result;
+            result.reserve(list.size());
+            for(const auto &item : list)
+            { result.push_back(std::get<int>(VariableUtils::borrowVarWithKey(item->getRef(), key)->getRef())); }
+            return result;
+        }
+        if(common == Type::STRING)
+        {
+            stringList result;
+            result.reserve(list.size());
+            for(const auto &item : list)
+            {
+                const varType &value = item->getRef();
+                if(std::holds_alternative<varMapType>(value))
+                { result.push_back(std::get<std::string>(VariableUtils::borrowVarWithKey(value, key)->getRef())); }
+                else
+                { result.emplace_back(VariableUtils::viewWithKey(value, std::string(key.str()))); }
+            }
+            return result;
+        }
+
+        listObj result;
+        result.reserve(list.size());
+        for(const auto &item : list)
+        {
+            varType &value = item->getRef();
+            if(std::holds_alternative<varMapType>(value))
+            {
+                auto var = VariableUtils::getVarWithKey(value, key);
+                result.push_back(var? var : allocateVar({}, std::monostate()));
+            }
+            else
+            { result.push_back(allocateVar({}, std::string(VariableUtils::viewWithKey(value, std::string(key.str()))))); }
+        }
+        return result;
+    }
+
+    void walk(Value &value, const std::vector<Symbol> &path)
+    {
+        static const Symbol elements("elements");
+        for(Symbol key : path)
+        {
+            const varType &current = value.get();
+            if(key == elements && ListObjUtils::isList(current)) // winners.elements.name: the list itself
+            { continue; }
+            if(std::holds_alternative<varMapType>(current))
+            {
+                auto var = VariableUtils::borrowVarWithKey(current, key);
+                if(tracking) { track(VariableUtils::getVarWithKey(current, key)); }
+                if(var == nullptr)
+                { value = {nullptr, std::monostate(), true}; }
+                else if(value.borrowed) { value.borrowed = &var->getRef(); }
+                else { value.owned = varType(var->getRef()); }
+            }
+            else if(std::holds_alternative<mapType>(current))
+            { value = {nullptr, std::string(VariableUtils::viewWithKey(current, std::string(key.str())))}; }
+            else if(auto list = std::get_if<listObj>(&current))
+            { value = {nullptr, eachWithKey(*list, key)}; }
+            else
+            { throw BadVariableArgException("No '" + std::string(key.str()) + "' in a non map value"); }
+        }
+    }
+
+    varType upfrom(const varType &to, const varType &from)
+    {
+        auto last = std::get_if<int>(&to);
+        auto first = std::get_if<int>(&from);
+        if(last == nullptr || first == nullptr)
+        { throw BadVariableArgException("Expected int upfrom int"); }
+
+        intList result;
+        if(*last >= *first) { result.reserve(*last - *first + 1); }
+        for(int i = *first; i <= *last; i++) { result.push_back(i); }
+        return result;
+    }
+}
+
+bool Expression::equals(const varType &a, const varType &b)
+{
+    if(a.index() != b.index() && !(ListObjUtils::isList(a) && ListObjUtils::isList(b)))
+    { return false; }
+    return VariableUtils::compare(a, b);
+}
+
+// reads of names record what the name found (even nothing), so a later set of that name is noticed
+static void trackName(EnvironmentManager &mgr, Symbol name, SlotRef slot)
+{
+    auto var = mgr.getVariable(name, slot);
+    uint64_t version = var? var->version() : 0;
+    tracking->push_back({std::move(var), version, name, slot, true});
+}
+
+varType Expression::evaluate(EnvironmentManager &mgr) const
+{
+    varType result;
+    evaluate(mgr, [&result](const varType &value, bool) { result = value; });
+    return result;
+}
+
+void Expression::evaluate(EnvironmentManager &mgr, const std::function<void(const varType&, bool)> &use,
+                          std::vector<Dependency>* deps) const
+{
+    MemoryResourceGuard guard(mgr.getMemoryResource());
+    auto outerTracking = tracking;
+    if(deps) { tracking = deps; } // templates' lookups are evaluated inside this one and record into the same deps
+    const size_t base = stack.size();
+    const size_t loopBase = loops.size();
+    auto pop = [](){ Value value = std::move(stack.back()); stack.pop_back(); return value; };
+
+    try
+    {
+        for(size_t pc = 0; pc < instructions.size(); pc++)
+        {
+            const Instruction &instruction = instructions[pc];
+            switch(instruction.op)
+            {
+                case Op::CONST:
+                    stack.push_back({&constants[instruction.arg], varType(), false});
+                    break;
+                case Op::LOAD:
+                {
+                    const Name &name = names[instruction.arg];
+                    Value value;
+                    if(tracking)
+                    {
+                        trackName(mgr, name.root, name.slot);
+                        if(!name.path.empty()) { trackName(mgr, name.whole, {}); }
+                    }
+                    if(auto var = mgr.borrowVariable(name.root, name.slot))
+                    {
+                        value.borrowed = &var->getRef();
+                        walk(value, name.path);
+                    }
+                    else if(auto whole = name.path.empty()? nullptr : mgr.borrowVariable(name.whole.str()))
+                    { value.borrowed = &whole->getRef(); } // dotted names can be set as one name
+                    else
+                    { value = {&constants[name.fallback], {}, true}; }
+                    stack.push_back(std::move(value));
+                    break;
+                }
+                case Op::LOAD_LOCAL:
+                {
+                    const Name &name = names[instruction.arg];
+                    Value value{&loops[loopBase + name.local].current->getRef(), varType(), false};
+                    walk(value, name.path);
+                    stack.push_back(std::move(value));
+                    break;
+                }
+                case Op::TEMPLATE:
+                    templates[instruction.arg]->render(mgr, buffer);
+                    stack.push_back({nullptr, buffer, false});
+                    break;
+                case Op::SIZE:
+                {
+                    int size = VariableUtils::size(stack.back().get());
+                    stack.back() = {nullptr, size};
+                    break;
+                }
+                case Op::CONTAINS:
+                {
+                    Value key = pop();
+                    bool found = ListObjUtils::contains(stack.back().get(), key.get());
+                    stack.back() = {nullptr, found};
+                    break;
+                }
+                case Op::UPFROM:
+                {
+                    Value from = pop();
+                    stack.back() = {nullptr, upfrom(stack.back().get(), from.get())};
+                    break;
+                }
+                case Op::NOT:
+                    stack.back() = {nullptr, !toBool(stack.back().get())};
+                    break;
+                case Op::EQUALS:
+                {
+                    Value b = pop();
+                    stack.back() = {nullptr, equals(stack.back().get(), b.get())};
+                    break;
+                }
+                case Op::ADD:
+                {
+                    Value b = pop();
+                    auto x = std::get_if<int>(&stack.back().get());
+                    auto y = std::get_if<int>(&b.get());
+                    if(x == nullptr || y == nullptr)
+                    { throw BadVariableArgException("Expected int + int"); }
+                    stack.back() = {nullptr, *x + *y};
+                    break;
+                }
+                case Op::JUMP_IF_TRUE:
+                case Op::JUMP_IF_FALSE:
+                    if(toBool(stack.back().get()) == (instruction.op == Op::JUMP_IF_TRUE))
+                    { pc = instruction.arg - 1; }
+                    else { stack.pop_back(); }
+                    break;
+                case Op::TEST_BOOL:
+                    toBool(stack.back().get());
+                    break;
+                case Op::COLLECT:
+                {
+                    Loop &loop = loops.emplace_back();
+                    loop.list = pop().take(); // copy on write, so O(1)
+                    if(!ListObjUtils::isList(loop.list))
+                    { throw BadVariableArgException("Expected a list to collect from"); }
+                    loop.size = VariableUtils::size(loop.list);
+                    break;
+                }
+                case Op::NEXT:
+                {
+                    Loop &loop = loops.back();
+                    if(loop.index < loop.size)
+                    {
+                        loop.current = ListObjUtils::get_at(loop.list, (int) loop.index++);
+                        if(std::holds_alternative<listObj>(loop.list)) { track(loop.current); } // the list's own element
+                    }
+                    else
+                    {
+                        stack.push_back({nullptr, std::move(loop.result), false});
+                        loops.pop_back();
+                        pc = instruction.arg - 1;
+                    }
+                    break;
+                }
+                case Op::KEEP:
+                {
+                    Loop &loop = loops.back();
+                    if(toBool(pop().get()))
+                    { loop.result.push_back(loop.current); }
+                    pc = instruction.arg - 1;
+                    break;
+                }
+            }
+        }
+        use(stack.back().get(), !stack.back().missing);
+    }
+    catch(...)
+    {
+        stack.resize(base);
+        loops.resize(loopBase);
+        tracking = outerTracking;
+        throw;
+    }
+    stack.resize(base);
+    tracking = outerTracking;
+}
@@ -0,0 +1,106 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+#include "Variables.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+using namespace var;
+
+
+namespace env_mgr
+{
+    class EnvironmentManager;
+    class StringTemplate;
+
+    // a Variable an evaluation read, and its version at the time. by name ones were found by looking up name (slot),
+    // so they are also out of date once the name finds another Variable (e.g. the next element of a loop)
+    struct Dependency
+    {
+        std::shared_ptr<Variable> var; // kept alive so its address can't be reused. nullptr if the name wasn't set
+        uint64_t version = 0;
+        Symbol name;
+        SlotRef slot;
+        bool byName = false;
+    };
+
+    // an expression's tokens (parseExpression in RuleInterpreter: prefix operators, `object builtin arguments...`)
+    // compiled once into bytecode for a small stack machine. literals are parsed, operators/builtins looked up and
+    // names interned (with their slot from EnvironmentManager::resolve) at compile time, so evaluating only runs ops.
+    // supported: literals, names (dotted paths go into maps, and over every element of a list), = ! + | &,
+    // size, contains, upfrom, collect and quoted strings with {name} placeholders (see StringTemplate)
+    class Expression
+    {
+        public:
+            enum class Op : uint8_t
+            {
+                CONST,          // push constants[arg]
+                LOAD,           // push names[arg]: the variable, else the token itself as a string
+                LOAD_LOCAL,     // push names[arg] starting from the element collect is looking at
+                TEMPLATE,       // push templates[arg] rendered
+                SIZE,           // top = size of top
+                CONTAINS,       // top = second contains top
+                UPFROM,         // top = list of ints from top up to second
+                NOT,
+                EQUALS,
+                ADD,
+                JUMP_IF_TRUE,   // || and &&: if top is true/false keep it and jump to arg, else pop it.
+                JUMP_IF_FALSE,  //            throws if it isn't a bool
+                TEST_BOOL,      // throws if top isn't a bool
+                COLLECT,        // pop a list and start a collect loop binding names[arg]
+                NEXT,           // next element of the collect loop, or push the result and jump to arg when done
+                KEEP,           // pop the condition, keep the element if true, jump back to arg
+            };
+            struct Instruction
+            {
+                Op op;
+                uint32_t arg = 0;
+            };
+
+            using SlotLookup = std::function<SlotRef(Symbol)>;
+
+            // tokens have to be exactly one expression, else throws BadVariableArgException.
+            // slots (same length as tokens, from RuleNode::getSlots()) make variable lookups O(1), lookup gives the
+            // slots of names that don't have one there (placeholders in strings)
+            static Expression compile(const std::vector<std::string> &tokens, const std::vector<SlotRef> &slots = {},
+                                      const SlotLookup &lookup = {});
+
+            varType evaluate(EnvironmentManager &mgr) const; // throws BadVariableArgException on type errors
+            // use gets the result without it being copied (only valid during the call). found is false if the
+            // expression is a name that isn't set (value is then the name as a string).
+            // deps (if given) gets every Variable the result was computed from, see EnvironmentManager::evaluateCached
+            void evaluate(EnvironmentManager &mgr, const std::function<void(const varType &value, bool found)> &use,
+                          std::vector<Dependency>* deps = nullptr) const;
+
+            uint64_t getId() const { return id; } // same for copies, never reused by another compile()
+            // what = does: values of different types are never equal, except typed lists and listObjs
+            static bool equals(const varType &a, const varType &b);
+
+            const std::vector<Instruction>& code() const { return instructions; }
+            // the value if the expression is a literal (evaluates to the same thing in any scope), else nullptr
+            const varType* constant() const
+            { return instructions.size() == 1 && instructions[0].op == Op::CONST? &constants[instructions[0].arg] : nullptr; }
+        private:
+            friend class ExpressionCompiler;
+
+            struct Name
+            {
+                Symbol root;
+                SlotRef slot;
+                std::vector<Symbol> path; // dotted keys after root
+                Symbol whole; // the token as one name
+                uint32_t fallback; // constant holding the token as a string
+                uint32_t local = 0; // LOAD_LOCAL: which collect loop
+            };
+
+            uint64_t id = 0;
+            std::vector<Instruction> instructions;
+            std::vector<varType> constants;
+            std::vector<Name> names;
+            std::vector<std::shared_ptr<const StringTemplate>> templates;
+    };
+};
+
+#endif
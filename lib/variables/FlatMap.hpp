@@ -0,0 +1,173 @@
+#ifndef FLAT_MAP_H
+#define FLAT_MAP_H
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+
+
+namespace var {
+// hash map with all entries in one contiguous vector (kept in insertion order).
+// maps with up to SmallSize entries (most scopes and player records) are searched with a linear scan and
+// don't allocate an index. bigger maps also keep an open addressing (linear probing) index into the entries
+template <typename K, typename V, typename Alloc, size_t SmallSize = 8, typename Hash = std::hash<K>>
+class FlatMap
+{
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;
+        using allocator_type = Alloc;
+        using size_type = size_t;
+    private:
+        using entryVec = std::vector<value_type, allocator_type>;
+        using indexAlloc = typename std::allocator_traits<allocator_type>::template rebind_alloc<uint32_t>;
+    public:
+        using iterator = typename entryVec::iterator;
+        using const_iterator = typename entryVec::const_iterator;
+
+        FlatMap() = default;
+        explicit FlatMap(const allocator_type &alloc): entries(alloc), index(indexAlloc(alloc)) {}
+        FlatMap(const FlatMap &other, const allocator_type &alloc):
+            entries(other.entries, alloc), index(other.index, indexAlloc(alloc)) {}
+        FlatMap(const FlatMap &other) = default;
+        FlatMap(FlatMap &&other) noexcept = default;
+        FlatMap& operator=(const FlatMap &other) = default;
+        FlatMap& operator=(FlatMap &&other) noexcept = default;
+        FlatMap(std::initializer_list<value_type> items) { for(const auto &item: items) { insert(item); } }
+
+        allocator_type get_allocator() const { return entries.get_allocator(); }
+
+        iterator begin() { return entries.begin(); }
+        iterator end() { return entries.end(); }
+        const_iterator begin() const { return entries.begin(); }
+        const_iterator end() const { return entries.end(); }
+
+        size_type size() const { return entries.size(); }
+        bool empty() const { return entries.empty(); }
+        void clear() { entries.clear(); index.clear(); }
+
+        iterator find(const K &key) { return entries.begin() + findIndex(key); }
+        const_iterator find(const K &key) const { return entries.begin() + findIndex(key); }
+        size_type count(const K &key) const { return find(key) == end()? 0 : 1; }
+        bool contains(const K &key) const { return find(key) != end(); }
+
+        V& at(const K &key)
+        {
+            auto it = find(key);
+            if(it == end()) { throw std::out_of_range("FlatMap::at: key not found"); }
+            return it->second;
+        }
+        const V& at(const K &key) const { return const_cast<FlatMap*>(this)->at(key); }
+
+        V& operator[](const K &key) { return try_emplace(key).first->second; }
+
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const K &key, Args&&... args)
+        {
+            size_t i = findIndex(key);
+            if(i != entries.size())
+            { return {entries.begin() + i, false}; }
+
+            entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+            indexInsert(entries.size() - 1);
+            return {entries.end() - 1, true};
+        }
+        std::pair<iterator, bool> insert(const value_type &item) { return try_emplace(item.first, item.second); }
+
+        size_type erase(const K &key)
+        {
+            auto it = find(key);
+            if(it == end()) { return 0; }
+            erase(it);
+            return 1;
+        }
+        iterator erase(const_iterator pos)
+        {
+            auto offset = pos - entries.cbegin();
+            entries.erase(pos); // keeps insertion order
+            rebuildIndex();
+            return entries.begin() + offset;
+        }
+
+        // same entries, order doesn't matter
+        bool operator==(const FlatMap &other) const
+        {
+            return size() == other.size() &&
+                std::all_of(begin(), end(), [&other](const auto &item)
+                {
+                    auto it = other.find(item.first);
+                    return it != other.end() && it->second == item.second;
+                });
+        }
+
+    private:
+        static size_t mix(size_t hash) { return hash * 0x9E3779B97F4A7C15ull; } // spread sequential ids
+        size_t slotFor(const K &key) const { return (mix(Hash{}(key)) >> 32) & (index.size() - 1); }
+
+        // returns entries.size() if not found
+        size_t findIndex(const K &key) const
+        {
+            if(index.empty()) // small map: linear scan
+            {
+                auto it = std::find_if(entries.begin(), entries.end(),
+                    [&key](const auto &item) { return item.first == key; });
+                return it - entries.begin();
+            }
+            for(size_t slot = slotFor(key); index[slot] != 0; slot = (slot + 1) & (index.size() - 1))
+            {
+                if(entries[index[slot] - 1].first == key)
+                { return index[slot] - 1; }
+            }
+            return entries.size();
+        }
+
+        void indexInsert(size_t entryIndex)
+        {
+            if(entries.size() <= SmallSize)
+            { return; }
+            if(index.empty() || entries.size() * 2 > index.size()) // keep load factor <= 0.5
+            { rebuildIndex(); return; }
+            placeInIndex(entryIndex);
+        }
+        void placeInIndex(size_t entryIndex)
+        {
+            size_t slot = slotFor(entries[entryIndex].first);
+            while(index[slot] != 0)
+            { slot = (slot + 1) & (index.size() - 1); }
+            index[slot] = entryIndex + 1; // 0 marks an empty slot
+        }
+        void rebuildIndex()
+        {
+            index.clear();
+            if(entries.size() <= SmallSize)
+            { index.shrink_to_fit(); return; }
+
+            size_t capacity = 32;
+            while(capacity < entries.size() * 4) { capacity *= 2; }
+            index.assign(capacity, 0);
+            for(size_t i = 0; i < entries.size(); i++) { placeInIndex(i); }
+        }
+
+        entryVec entries;
+        std::vector<uint32_t, indexAlloc> index;
+};
+
+// ordered view over a FlatMap for output that should not depend on insertion order
+template <typename Map, typename Compare>
+std::vector<const typename Map::value_type*> ordered(const Map &map, Compare comp)
+{
+    std::vector<const typename Map::value_type*> items;
+    items.reserve(map.size());
+    std::for_each(map.begin(), map.end(), [&items](const auto &item) { items.push_back(&item); });
+    std::sort(items.begin(), items.end(),
+        [&comp](const auto *a, const auto *b) { return comp(a->first, b->first); });
+    return items;
+}
+};
+
+#endif
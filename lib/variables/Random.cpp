@@ -0,0 +1,66 @@
+#include "Random.hpp"
+#include <random>
+
+using namespace var;
+
+
+namespace
+{
+    uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    // expands the seed so similar seeds still give unrelated states
+    uint64_t splitmix64(uint64_t &x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+
+Random::Random()
+{
+    std::random_device rd;
+    seed((uint64_t(rd()) << 32) | rd());
+}
+Random::Random(uint64_t aSeed) { seed(aSeed); }
+
+void Random::seed(uint64_t aSeed)
+{
+    initialSeed = aSeed;
+    for(auto &word: state) { word = splitmix64(aSeed); }
+}
+
+Random::result_type Random::operator()()
+{
+    const uint64_t result = rotl(state[1] * 5, 7) * 9;
+    const uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+
+    return result;
+}
+
+std::ostream& var::operator<<(std::ostream &stream, const Random &rng)
+{
+    stream << rng.getSeed();
+    for(auto word: rng.getState()) { stream << ' ' << word; }
+    return stream;
+}
+std::istream& var::operator>>(std::istream &stream, Random &rng)
+{
+    uint64_t seed;
+    Random::stateType state;
+    if(stream >> seed >> state[0] >> state[1] >> state[2] >> state[3])
+    {
+        rng.seed(seed);
+        rng.setState(state);
+    }
+    return stream;
+}
@@ -0,0 +1,42 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <iostream>
+
+
+namespace var {
+// xoshiro256** generator. cheap to construct/call, so each GameInstance owns one and every random rule
+// (shuffle, deal, ...) draws from it. seeding with the same value replays the same sequence.
+// satisfies UniformRandomBitGenerator so it works with std::shuffle/std::uniform_int_distribution
+class Random
+{
+    public:
+        using result_type = uint64_t;
+        using stateType = std::array<uint64_t, 4>;
+
+        Random(); // seeded once from std::random_device
+        explicit Random(uint64_t aSeed);
+
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+        result_type operator()();
+
+        void seed(uint64_t aSeed);
+        uint64_t getSeed() const { return initialSeed; }
+
+        // full generator position, for saving/restoring a session mid game
+        const stateType& getState() const { return state; }
+        void setState(const stateType &aState) { state = aState; }
+
+        bool operator==(const Random &other) const { return state == other.state; }
+    private:
+        uint64_t initialSeed = 0;
+        stateType state;
+};
+std::ostream& operator<<(std::ostream &stream, const Random &rng);
+std::istream& operator>>(std::istream &stream, Random &rng);
+};
+
+#endif
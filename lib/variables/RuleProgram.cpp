@@ -0,0 +1,233 @@
+#include "RuleProgram.hpp"
+#include "EnvironmentMgr.hpp"
+
+
+using namespace env_mgr;
+
+
+namespace env_mgr
+{
+    class RuleLowering
+    {
+        public:
+            RuleLowering(RuleProgram &aProgram): program(aProgram) {}
+
+            void lower(const std::shared_ptr<RuleNode> &first)
+            {
+                for(auto node = first; node; node = node->getNextNode())
+                {
+                    program.positions.emplace(node.get(), program.instructions.size());
+                    auto nodeType = node->getType();
+                    if(nodeType == NodeType::FOR || nodeType == NodeType::PARALLEL) { loop(node); }
+                    else if(nodeType == NodeType::MATCH) { match(node); }
+                    else { emit(RuleProgram::Op::TASK, node); }
+                }
+            }
+        private:
+            uint32_t emit(RuleProgram::Op op, const std::shared_ptr<RuleNode> &node = nullptr, uint32_t jump = 0)
+            {
+                program.instructions.push_back({op, jump, 0, node});
+                return program.instructions.size() - 1;
+            }
+            uint32_t here() const { return program.instructions.size(); }
+
+            // the expression resolve() compiled for tokens (nullptr if it couldn't), or tokens compiled now if the
+            // rules weren't resolved
+            uint32_t expression(const std::vector<std::shared_ptr<const Expression>> &resolved, size_t i,
+                const std::vector<std::string> &tokens)
+            {
+                std::shared_ptr<const Expression> compiled;
+                if(i < resolved.size()) { compiled = resolved[i]; }
+                else
+                {
+                    try { compiled = std::make_shared<const Expression>(Expression::compile(tokens)); }
+                    catch(const BadVariableArgException &) { }
+                }
+                if(!compiled)
+                { return RuleProgram::never; }
+                program.expressions.push_back(std::move(compiled));
+                return program.expressions.size() - 1;
+            }
+
+            void loop(const std::shared_ptr<RuleNode> &node)
+            {
+                uint32_t start = emit(RuleProgram::Op::LOOP, node);
+                static const std::vector<std::string> loopBody = {"true"};
+                for(const auto &child : node->getBody())
+                {
+                    if(child.key == loopBody) { lower(child.child); }
+                }
+                emit(RuleProgram::Op::NEXT, node, start + 1);
+                program.instructions[start].jump = here();
+            }
+
+            void match(const std::shared_ptr<RuleNode> &node)
+            {
+                uint32_t start = emit(RuleProgram::Op::MATCH, node);
+                const auto &data = node->getData();
+                const auto &body = node->getBody();
+
+                // arms are reserved up front, nested matches add theirs after
+                RuleProgram::Match entry;
+                entry.target = data.empty()? RuleProgram::never : expression(node->getExpressions(), 0, data[0]);
+                uint32_t firstArm = program.arms.size();
+                program.arms.resize(program.arms.size() + body.size());
+                for(size_t i = 0; i < body.size(); i++)
+                {
+                    uint32_t arm = firstArm + i;
+                    uint32_t guard = expression(node->getGuards(), i, body[i].key);
+                    program.arms[arm].guard = guard;
+                    if(guard != RuleProgram::never) { addArm(entry, arm, *program.expressions[guard]); }
+                }
+                uint32_t index = program.matches.size();
+                program.instructions[start].arg = index;
+                program.matches.push_back(std::move(entry));
+
+                std::vector<uint32_t> exits;
+                for(size_t i = 0; i < body.size(); i++)
+                {
+                    program.arms[firstArm + i].body = here();
+                    lower(body[i].child);
+                    exits.push_back(emit(RuleProgram::Op::JUMP));
+                }
+                uint32_t exit = emit(RuleProgram::Op::EXIT, node);
+                for(uint32_t jump : exits) { program.instructions[jump].jump = exit; }
+                program.instructions[start].jump = exit;
+            }
+
+            // a repeated literal keeps its first arm, like checking the guards in order would
+            static void addArm(RuleProgram::Match &entry, uint32_t arm, const Expression &guard)
+            {
+                const varType* value = guard.constant();
+                if(auto number = value? std::get_if<int>(value) : nullptr) { entry.ints.emplace(*number, arm); }
+                else if(auto string = value? std::get_if<std::string>(value) : nullptr) { entry.strings.emplace(*string, arm); }
+                else if(auto boolean = value? std::get_if<bool>(value) : nullptr)
+                {
+                    if(entry.bools[*boolean] == RuleProgram::never) { entry.bools[*boolean] = arm; }
+                }
+                else { entry.dynamic.push_back(arm); }
+            }
+
+            RuleProgram &program;
+    };
+};
+
+std::shared_ptr<const RuleProgram> RuleProgram::lower(const std::shared_ptr<RuleNode> &first)
+{
+    auto program = std::make_shared<RuleProgram>();
+    program->rules = first;
+    RuleLowering(*program).lower(first);
+    return program;
+}
+
+std::optional<size_t> RuleProgram::pcOf(const RuleNode* node) const
+{
+    auto it = positions.find(node);
+    return it == positions.end()? std::nullopt : std::optional<size_t>(it->second);
+}
+
+uint32_t RuleProgram::Match::find(const varType &value) const
+{
+    if(auto number = std::get_if<int>(&value))
+    {
+        auto it = ints.find(*number);
+        return it == ints.end()? never : it->second;
+    }
+    if(auto string = std::get_if<std::string>(&value))
+    {
+        auto it = strings.find(*string);
+        return it == strings.end()? never : it->second;
+    }
+    if(auto boolean = std::get_if<bool>(&value)) { return bools[*boolean]; }
+    return never; // literals are never equal to a value of another type
+}
+
+size_t RuleProgram::dispatch(uint32_t match, size_t exit, EnvironmentManager &mgr) const
+{
+    const Match &entry = matches[match];
+    if(entry.target == never)
+    { return exit; }
+
+    // through the manager's memo, so a target or guard whose inputs haven't changed since the last time the match
+    // ran isn't evaluated again
+    const varType &target = mgr.evaluateCached(*expressions[entry.target]);
+    uint32_t found = entry.find(target);
+    for(uint32_t arm : entry.dynamic)
+    {
+        if(arm > found)
+        { break; }
+        if(Expression::equals(mgr.evaluateCached(*expressions[arms[arm].guard]), target))
+        { return arms[arm].body; }
+    }
+    return found == never? exit : arms[found].body;
+}
+
+
+// ==========================================RuleExecutor==========================================
+RuleExecutor::RuleExecutor(std::shared_ptr<const RuleProgram> aProgram, EnvironmentManager &amgr):
+    program(std::move(aProgram)), mgr(&amgr)
+{ }
+
+const std::shared_ptr<RuleNode>& RuleExecutor::next()
+{
+    static const std::shared_ptr<RuleNode> none;
+    const auto &code = program->code();
+    while(pc < code.size())
+    {
+        const RuleProgram::Instruction &instruction = code[pc];
+        switch(instruction.op)
+        {
+            case RuleProgram::Op::TASK:
+                pc++;
+                return instruction.node;
+            case RuleProgram::Op::LOOP:
+                mgr->pushScope(instruction.node);
+                if(mgr->nextElement()) { pc++; }
+                else
+                {
+                    mgr->popScope();
+                    pc = instruction.jump;
+                }
+                break;
+            case RuleProgram::Op::NEXT:
+                if(mgr->nextElement()) { pc = instruction.jump; }
+                else
+                {
+                    mgr->popScope();
+                    pc++;
+                }
+                break;
+            case RuleProgram::Op::MATCH:
+            {
+                // the target is evaluated outside the match's scope (see EnvironmentManager::resolve)
+                size_t arm = program->dispatch(instruction.arg, instruction.jump, *mgr);
+                mgr->pushScope(instruction.node);
+                pc = arm;
+                break;
+            }
+            case RuleProgram::Op::JUMP:
+                pc = instruction.jump;
+                break;
+            case RuleProgram::Op::EXIT:
+                mgr->popScope();
+                pc++;
+                break;
+        }
+    }
+    return none;
+}
+
+bool RuleExecutor::jumpTo(const RuleNode* node)
+{
+    auto target = program->pcOf(node);
+    if(target) { pc = *target; }
+    return target.has_value();
+}
+
+bool RuleExecutor::resume(size_t aPc)
+{
+    if(aPc > program->size())
+    { return false; }
+    pc = aPc;
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef RULE_PROGRAM_H
+#define RULE_PROGRAM_H
+#include "Expression.hpp"
+#include "RuleInterpreter.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace env_mgr
+{
+    class EnvironmentManager;
+
+    // a RuleTree lowered once into a flat array of instructions with jump targets, so running rules is stepping a
+    // program counter instead of following nextNode/parent/child pointers. immutable, so every game of the same
+    // rules shares one (each game has its own RuleExecutor).
+    //   for/parallel:  LOOP(jump: after) body... NEXT(jump: body)
+    //   match:         MATCH(jump: exit) arm body... JUMP(exit) ... EXIT
+    class RuleProgram
+    {
+        public:
+            enum class Op : uint8_t
+            {
+                TASK,   // hand node to the caller
+                LOOP,   // open the loop's scope and take the first element, or close it and jump if it's empty
+                NEXT,   // next element and jump back to the body, or close the loop's scope
+                MATCH,  // open the match's scope and jump to the first arm whose guard equals the target (else exit)
+                JUMP,
+                EXIT,   // close the scope of a match
+            };
+            struct Instruction
+            {
+                Op op;
+                uint32_t jump = 0;
+                uint32_t arg = 0; // MATCH: index into matches
+                std::shared_ptr<RuleNode> node; // TASK/LOOP/MATCH
+            };
+
+            // rules are expected to have been resolved (EnvironmentManager::resolve): the expressions it compiled are
+            // shared, not compiled again (rules that weren't are compiled here, looking variables up by name)
+            static std::shared_ptr<const RuleProgram> lower(const std::shared_ptr<RuleNode> &first);
+
+            const std::vector<Instruction>& code() const { return instructions; }
+            size_t size() const { return instructions.size(); }
+            std::optional<size_t> pcOf(const RuleNode* node) const; // where node's instruction is
+            // the rule tree it was lowered from (snapshots save rule nodes as positions in it)
+            const std::shared_ptr<RuleNode>& getRules() const { return rules; }
+
+            // pc of the arm of matches[match] to run, or exit if none matches. the target and guards go through
+            // mgr.evaluateCached()
+            size_t dispatch(uint32_t match, size_t exit, EnvironmentManager &mgr) const;
+        private:
+            friend class RuleLowering;
+
+            static constexpr uint32_t never = UINT32_MAX; // guard that didn't compile
+
+            struct Arm
+            {
+                uint32_t guard; // index into expressions
+                uint32_t body;
+            };
+            // arms whose guard is a literal are found by the target's value, the others are evaluated in order
+            struct Match
+            {
+                uint32_t target; // index into expressions
+                std::unordered_map<int, uint32_t> ints; // literal -> first arm (index into arms) with it as guard
+                std::unordered_map<std::string, uint32_t> strings;
+                uint32_t bools[2] = {never, never};
+                std::vector<uint32_t> dynamic; // arms with other guards, in order
+
+                uint32_t find(const varType &value) const; // first arm with value as its literal, never if none
+            };
+
+            std::shared_ptr<RuleNode> rules;
+            std::vector<Instruction> instructions;
+            std::vector<std::shared_ptr<const Expression>> expressions;
+            std::vector<Arm> arms;
+            std::vector<Match> matches;
+            std::unordered_map<const RuleNode*, uint32_t> positions;
+    };
+
+    // runs one game's copy of a RuleProgram: control flow instructions are run against mgr, and each task is
+    // handed back to the caller (who converts and runs it). the program counter is the game's position in its rules
+    class RuleExecutor
+    {
+        public:
+            RuleExecutor(std::shared_ptr<const RuleProgram> aProgram, EnvironmentManager &amgr);
+
+            // runs up to the next task and returns its rule node (pc moves past it). nullptr once the rules are done
+            const std::shared_ptr<RuleNode>& next();
+            bool done() const { return pc >= program->size(); }
+            size_t getPc() const { return pc; }
+            const RuleProgram& getProgram() const { return *program; }
+            // continue at node (e.g. after a STOP timer, whose scopes mgr has already closed). false if node isn't
+            // one of the program's rules
+            bool jumpTo(const RuleNode* node);
+            // continue at a pc saved with getPc() once mgr has been restored from the snapshot taken with it (the
+            // scopes of the loops/matches pc is in are already open). false if pc isn't in the program
+            bool resume(size_t aPc);
+            void restart() { pc = 0; }
+        private:
+            std::shared_ptr<const RuleProgram> program;
+            EnvironmentManager* mgr;
+            size_t pc = 0;
+    };
+};
+
+#endif
@@ -0,0 +1,337 @@
+#include "Serializer.hpp"
+
+
+using namespace var;
+
+namespace
+{
+    constexpr std::string_view magic = "SGV";
+
+    // shared values: 0 = nullptr, 1 = new value follows, n + 2 = same as the nth shared value written
+    constexpr uint64_t nullRef = 0;
+    constexpr uint64_t newRef = 1;
+}
+
+// ============================================Encoder==============================================
+Encoder::Encoder()
+{
+    buffer.append(magic);
+    buffer.push_back((char) version);
+}
+
+void Encoder::writeUInt(uint64_t value)
+{
+    // LEB128: 7 bits per byte, high bit set if more follow
+    while(value >= 0x80)
+    {
+        buffer.push_back((char) (value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((char) value);
+}
+
+// zigzag so small negative numbers stay small
+void Encoder::writeInt(int64_t value) { writeUInt(((uint64_t) value << 1) ^ (uint64_t) (value >> 63)); }
+
+void Encoder::writeString(std::string_view value)
+{
+    writeUInt(value.size());
+    buffer.append(value);
+}
+
+void Encoder::writeSymbol(Symbol symbol)
+{
+    auto [it, added] = symbols.try_emplace(symbol, symbols.size());
+    if(!added)
+    {
+        writeUInt(it->second + 1);
+        return;
+    }
+    writeUInt(0);
+    writeString(symbol.str());
+}
+
+template <typename T>
+void Encoder::writeShared(const std::shared_ptr<T> &ptr, std::unordered_map<const std::remove_const_t<T>*, uint64_t> &seen)
+{
+    if(!ptr)
+    {
+        writeUInt(nullRef);
+        return;
+    }
+    auto [it, added] = seen.try_emplace(ptr.get(), seen.size());
+    if(!added)
+    {
+        writeUInt(it->second + 2);
+        return;
+    }
+
+    writeUInt(newRef);
+    if constexpr (std::is_same_v<T, Variable>) { write(ptr->getRef()); }
+    else if constexpr (std::is_same_v<T, const CardTable>)
+    {
+        writeUInt(ptr->size());
+        for(size_t code = 0; code < ptr->size(); code++)
+        {
+            writeInt((*ptr)[code].rank);
+            writeString((*ptr)[code].suit);
+            writeString((*ptr)[code].name);
+        }
+    }
+    else { writeString(*ptr); }
+}
+
+void Encoder::writeVar(const std::shared_ptr<Variable> &var) { writeShared(var, vars); }
+
+void Encoder::write(const varType &value)
+{
+    buffer.push_back((char) value.index());
+    if(auto val = std::get_if<int>(&value)) { writeInt(*val); }
+    else if(auto val = std::get_if<std::string>(&value)) { writeString(*val); }
+    else if(auto val = std::get_if<bool>(&value)) { buffer.push_back((char) *val); }
+    else if(auto map = std::get_if<mapType>(&value))
+    {
+        writeUInt(map->size());
+        for(const auto &[key, item] : *map)
+        {
+            writeSymbol(key);
+            writeShared(item, strings);
+        }
+    }
+    else if(auto list = std::get_if<listObj>(&value))
+    {
+        writeUInt(list->size());
+        for(const auto &item : *list) { writeVar(item); }
+    }
+    else if(auto map = std::get_if<varMapType>(&value))
+    {
+        writeUInt(map->size());
+        for(const auto &[key, item] : *map)
+        {
+            writeSymbol(key);
+            writeVar(item);
+        }
+    }
+    else if(auto list = std::get_if<intList>(&value))
+    {
+        writeUInt(list->size());
+        for(int item : *list) { writeInt(item); }
+    }
+    else if(auto list = std::get_if<stringList>(&value))
+    {
+        writeUInt(list->size());
+        for(const auto &item : *list) { writeString(item); }
+    }
+    else if(auto deck = std::get_if<deckObj>(&value))
+    {
+        writeShared(deck->table(), tables);
+        writeUInt(deck->size());
+        buffer.append(deck->begin(), deck->end()); // one byte per card
+    }
+    else if(std::holds_alternative<std::shared_ptr<void>>(value))
+    {
+        throw BadVariableArgException("Can't serialize a pointer");
+    }
+    // monostate has no payload
+}
+
+// ============================================Decoder==============================================
+Decoder::Decoder(std::string_view data): input(data)
+{
+    if(input.substr(0, magic.size()) != magic)
+    { throw BadVariableArgException("Not serialized game data"); }
+    pos = magic.size();
+    if(readByte() != Encoder::version)
+    { throw BadVariableArgException("Unsupported serialized data version"); }
+}
+
+uint8_t Decoder::readByte()
+{
+    if(pos >= input.size())
+    { throw BadVariableArgException("Serialized data is truncated"); }
+    return (uint8_t) input[pos++];
+}
+
+uint64_t Decoder::readUInt()
+{
+    uint64_t value = 0;
+    for(int shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte = readByte();
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+        { return value; }
+    }
+    throw BadVariableArgException("Serialized data has a bad number");
+}
+
+int64_t Decoder::readInt()
+{
+    uint64_t value = readUInt();
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+std::string Decoder::readString()
+{
+    uint64_t size = readUInt();
+    if(size > input.size() - pos)
+    { throw BadVariableArgException("Serialized data is truncated"); }
+    std::string value(input.substr(pos, size));
+    pos += size;
+    return value;
+}
+
+Symbol Decoder::readSymbol()
+{
+    uint64_t ref = readUInt();
+    if(ref == 0)
+    { return symbols.emplace_back(readString()); }
+    if(ref > symbols.size())
+    { throw BadVariableArgException("Serialized data has a bad reference"); }
+    return symbols[ref - 1];
+}
+
+std::shared_ptr<Variable> Decoder::readVar()
+{
+    uint64_t ref = readUInt();
+    if(ref == nullRef)
+    { return nullptr; }
+    if(ref != newRef)
+    {
+        if(ref - 2 >= vars.size())
+        { throw BadVariableArgException("Serialized data has a bad reference"); }
+        return vars[ref - 2];
+    }
+
+    // registered before its value is read so a list holding itself comes back the same way
+    auto var = allocateVar({}, varType());
+    vars.push_back(var);
+    var->getRef() = read();
+    return var;
+}
+
+varType Decoder::read()
+{
+    if(depth >= maxDepth)
+    { throw BadVariableArgException("Serialized data is nested too deeply"); }
+    depth++;
+    varType value = readValue();
+    depth--;
+    return value;
+}
+
+varType Decoder::readValue()
+{
+    switch((Type) readByte())
+    {
+        case Type::INT: return (int) readInt();
+        case Type::STRING: return readString();
+        case Type::BOOL: return readByte() != 0;
+        case Type::MAP:
+        {
+            mapType map;
+            for(uint64_t i = readUInt(); i > 0; i--)
+            {
+                Symbol key = readSymbol();
+                uint64_t ref = readUInt();
+                std::shared_ptr<std::string> item;
+                if(ref == newRef) { item = strings.emplace_back(std::make_shared<std::string>(readString())); }
+                else if(ref != nullRef)
+                {
+                    if(ref - 2 >= strings.size())
+                    { throw BadVariableArgException("Serialized data has a bad reference"); }
+                    item = strings[ref - 2];
+                }
+                map[key] = item;
+            }
+            return map;
+        }
+        case Type::LIST:
+        {
+            listObj list;
+            uint64_t size = readUInt();
+            list.reserve(std::min<uint64_t>(size, input.size() - pos)); // every element takes at least a byte
+            for(uint64_t i = 0; i < size; i++) { list.push_back(readVar()); }
+            return list;
+        }
+        case Type::VAR_MAP:
+        {
+            varMapType map;
+            for(uint64_t i = readUInt(); i > 0; i--)
+            {
+                Symbol key = readSymbol();
+                map[key] = readVar();
+            }
+            return map;
+        }
+        case Type::INT_LIST:
+        {
+            intList list;
+            uint64_t size = readUInt();
+            list.reserve(std::min<uint64_t>(size, input.size() - pos));
+            for(uint64_t i = 0; i < size; i++) { list.push_back((int) readInt()); }
+            return list;
+        }
+        case Type::STRING_LIST:
+        {
+            stringList list;
+            uint64_t size = readUInt();
+            list.reserve(std::min<uint64_t>(size, input.size() - pos));
+            for(uint64_t i = 0; i < size; i++) { list.push_back(readString()); }
+            return list;
+        }
+        case Type::DECK:
+        {
+            std::shared_ptr<const CardTable> table;
+            uint64_t ref = readUInt();
+            if(ref == newRef)
+            {
+                // codes are one byte, and a card takes at least 3 (rank, suit and name lengths)
+                uint64_t count = readUInt();
+                if(count > 256 || count > (input.size() - pos) / 3)
+                { throw BadVariableArgException("Serialized deck has a bad card count"); }
+                std::vector<Card> cards(count);
+                for(auto &card : cards)
+                {
+                    card.rank = (int) readInt();
+                    card.suit = readString();
+                    card.name = readString();
+                }
+                table = tables.emplace_back(std::make_shared<const CardTable>(std::move(cards)));
+            }
+            else if(ref != nullRef)
+            {
+                if(ref - 2 >= tables.size())
+                { throw BadVariableArgException("Serialized data has a bad reference"); }
+                table = tables[ref - 2];
+            }
+
+            deckObj deck;
+            deck.setTable(table);
+            std::string codes = readString();
+            if(!table && !codes.empty())
+            { throw BadVariableArgException("Serialized deck has cards but no table"); }
+            if(table && std::any_of(codes.begin(), codes.end(), [&table](char code) { return (uint8_t) code >= table->size(); }))
+            { throw BadVariableArgException("Serialized deck has a card that isn't in its table"); }
+            deck.append(codes.begin(), codes.end());
+            return deck;
+        }
+        case Type::NONE: return std::monostate();
+        default:
+            throw BadVariableArgException("Serialized data has an unknown type");
+    }
+}
+
+// ==============================================Other=============================================
+std::string var::serialize(const varType &value)
+{
+    Encoder encoder;
+    encoder.write(value);
+    return encoder.release();
+}
+
+varType var::deserialize(std::string_view data)
+{
+    Decoder decoder(data);
+    return decoder.read();
+}
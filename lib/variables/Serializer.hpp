@@ -0,0 +1,80 @@
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+#include "Variables.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+namespace var {
+// compact binary encoding of varType, for checkpointing games and moving them between processes.
+// layout: header ("SGV" + version byte) then values as [Type byte][payload]. ints are zigzag varints,
+// strings/lists/maps are length prefixed, map keys are written by name once and by index after that.
+// a Variable (or map string, card table) reachable from several places is written once and referenced after that,
+// so values shared between scopes/lists are still shared after decoding.
+// everything written by one Encoder has to be read back by one Decoder, in the same order
+class Encoder
+{
+    public:
+        static constexpr uint8_t version = 3; // 2: deckObj, 3: snapshot timers in ms
+
+        Encoder(); // writes the header
+
+        void write(const varType &value); // throws BadVariableArgException for POINTER
+        void writeVar(const std::shared_ptr<Variable> &var); // nullptr allowed
+        void writeUInt(uint64_t value);
+        void writeInt(int64_t value);
+        void writeString(std::string_view value);
+        void writeSymbol(Symbol symbol);
+
+        const std::string& data() const { return buffer; }
+        std::string release() { return std::move(buffer); }
+    private:
+        template <typename T>
+        void writeShared(const std::shared_ptr<T> &ptr, std::unordered_map<const std::remove_const_t<T>*, uint64_t> &seen);
+
+        std::string buffer;
+        std::unordered_map<const Variable*, uint64_t> vars;
+        std::unordered_map<const std::string*, uint64_t> strings;
+        std::unordered_map<const CardTable*, uint64_t> tables;
+        std::unordered_map<Symbol, uint64_t> symbols;
+};
+
+// reads what Encoder wrote. containers/Variables are allocated from memoryResource().
+// throws BadVariableArgException on a bad header, unknown version, truncated data or values nested too deeply
+class Decoder
+{
+    public:
+        static constexpr size_t maxDepth = 256; // lists/maps inside each other, so bad data can't run out the stack
+
+        Decoder(std::string_view data);
+
+        varType read();
+        std::shared_ptr<Variable> readVar();
+        uint64_t readUInt();
+        int64_t readInt();
+        std::string readString();
+        Symbol readSymbol();
+
+        bool atEnd() const { return pos == input.size(); }
+        size_t remaining() const { return input.size() - pos; }
+    private:
+        uint8_t readByte();
+        varType readValue();
+
+        std::string_view input;
+        size_t pos = 0;
+        size_t depth = 0;
+        std::vector<std::shared_ptr<Variable>> vars;
+        std::vector<std::shared_ptr<std::string>> strings;
+        std::vector<std::shared_ptr<const CardTable>> tables;
+        std::vector<Symbol> symbols;
+};
+
+std::string serialize(const varType &value);
+varType deserialize(std::string_view data);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "StringTemplate.hpp"
+#include "EnvironmentMgr.hpp"
+#include <charconv>
+#include <sstream>
+
+
+using namespace env_mgr;
+
+
+StringTemplate StringTemplate::compile(std::string_view text, const Expression::SlotLookup &lookup)
+{
+    StringTemplate result;
+    result.text = text;
+    size_t pos = 0;
+    while(pos < text.size())
+    {
+        size_t open = text.find('{', pos);
+        size_t close = open == std::string_view::npos? open : text.find('}', open);
+        if(close == std::string_view::npos) // no more placeholders
+        { open = close = text.size(); }
+
+        if(open > pos)
+        {
+            result.segments.push_back({(uint32_t) pos, (uint32_t) (open - pos)});
+            result.literalSize += open - pos;
+        }
+        if(close == text.size())
+        { break; }
+
+        // "{ player.name }" -> player.name. empty braces stay literal text
+        std::string_view name = text.substr(open + 1, close - open - 1);
+        name.remove_prefix(std::min(name.find_first_not_of(' '), name.size()));
+        name.remove_suffix(name.size() - std::min(name.find_last_not_of(' ') + 1, name.size()));
+        Segment segment{(uint32_t) open, (uint32_t) (close + 1 - open)};
+        if(!name.empty())
+        {
+            segment.lookup = result.lookups.size();
+            result.lookups.push_back(Expression::compile({std::string(name)}, {}, lookup));
+        }
+        else { result.literalSize += segment.size; }
+        result.segments.push_back(segment);
+        pos = close + 1;
+    }
+    return result;
+}
+
+void StringTemplate::render(EnvironmentManager &mgr, std::string &out) const
+{
+    out.clear();
+    out.reserve(literalSize + 16 * lookups.size());
+    for(const Segment &segment : segments)
+    {
+        std::string_view literal(text.data() + segment.offset, segment.size);
+        if(segment.lookup < 0)
+        {
+            out.append(literal);
+            continue;
+        }
+
+        lookups[segment.lookup].evaluate(mgr, [&](const varType &value, bool found)
+        {
+            if(found) { appendValue(out, value); }
+            else { out.append(literal); }
+        });
+    }
+}
+
+std::string StringTemplate::render(EnvironmentManager &mgr) const
+{
+    std::string out;
+    render(mgr, out);
+    return out;
+}
+
+void env_mgr::appendValue(std::string &out, const varType &value, std::string_view delim)
+{
+    if(auto string = std::get_if<std::string>(&value)) { out.append(*string); }
+    else if(auto number = std::get_if<int>(&value))
+    {
+        char digits[16];
+        auto end = std::to_chars(digits, digits + sizeof(digits), *number).ptr;
+        out.append(digits, end);
+    }
+    else if(auto boolean = std::get_if<bool>(&value)) { out.append(*boolean? "true" : "false"); }
+    else if(auto list = std::get_if<listObj>(&value))
+    {
+        for(size_t i = 0; i < list->size(); i++)
+        {
+            if(i > 0) { out.append(delim); }
+            appendValue(out, (*list)[i]->getRef(), delim);
+        }
+    }
+    else if(auto list = std::get_if<intList>(&value))
+    {
+        for(size_t i = 0; i < list->size(); i++)
+        {
+            if(i > 0) { out.append(delim); }
+            appendValue(out, (*list)[i], delim);
+        }
+    }
+    else if(auto list = std::get_if<stringList>(&value))
+    {
+        for(size_t i = 0; i < list->size(); i++)
+        {
+            if(i > 0) { out.append(delim); }
+            out.append((*list)[i]);
+        }
+    }
+    else if(auto deck = std::get_if<deckObj>(&value))
+    {
+        for(size_t i = 0; i < deck->size(); i++)
+        {
+            if(i > 0) { out.append(delim); }
+            out.append(deck->card(i).name);
+        }
+    }
+    else if(!std::holds_alternative<std::monostate>(value)) // maps
+    {
+        std::ostringstream stream;
+        VariableUtils::printValue(value, delim, stream);
+        out.append(stream.str());
+    }
+}
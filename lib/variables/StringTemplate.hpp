@@ -0,0 +1,42 @@
+#ifndef STRING_TEMPLATE_H
+#define STRING_TEMPLATE_H
+#include "Expression.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace env_mgr
+{
+    // a string with {name} placeholders ("Round {round}. Choose your weapon!", "{player.name}, choose!"), split once
+    // into literal spans and compiled lookups. render() fills the placeholders in from the current scopes.
+    // lists are joined with ", " (e.g. {winners.elements.name}), names that aren't set are left as {name}
+    class StringTemplate
+    {
+        public:
+            static StringTemplate compile(std::string_view text, const Expression::SlotLookup &lookup = {});
+
+            // out is cleared and reused, so a caller that keeps one buffer only allocates when a render outgrows it
+            void render(EnvironmentManager &mgr, std::string &out) const;
+            std::string render(EnvironmentManager &mgr) const;
+
+            size_t placeholders() const { return lookups.size(); }
+        private:
+            struct Segment
+            {
+                uint32_t offset; // into text
+                uint32_t size;
+                int lookup = -1; // index into lookups, -1 for literal text
+            };
+
+            std::string text;
+            std::vector<Segment> segments;
+            std::vector<Expression> lookups;
+            size_t literalSize = 0;
+    };
+
+    // appends value as text: strings as they are, lists joined with delim
+    void appendValue(std::string &out, const varType &value, std::string_view delim = ", ");
+};
+
+#endif
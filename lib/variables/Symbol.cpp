@@ -0,0 +1,73 @@
+#include "Symbol.hpp"
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+
+using namespace var;
+
+
+// ==========================================symbol table==========================================
+namespace
+{
+    struct SymbolTable
+    {
+        SymbolTable() { intern(""); } // id 0
+
+        unsigned int intern(std::string_view name)
+        {
+            {
+                std::shared_lock lock(mutex);
+                auto it = ids.find(name);
+                if(it != ids.end())
+                { return it->second; }
+            }
+            std::unique_lock lock(mutex);
+            auto it = ids.find(name); // may have been added while unlocked
+            if(it != ids.end())
+            { return it->second; }
+
+            names.emplace_back(name); // deque so string_view keys stay valid
+            unsigned int id = names.size() - 1;
+            ids.emplace(names.back(), id);
+            return id;
+        }
+
+        std::optional<unsigned int> find(std::string_view name)
+        {
+            std::shared_lock lock(mutex);
+            auto it = ids.find(name);
+            return it == ids.end()? std::nullopt : std::optional<unsigned int>(it->second);
+        }
+
+        std::string_view str(unsigned int id)
+        {
+            std::shared_lock lock(mutex);
+            return names.at(id);
+        }
+
+        std::shared_mutex mutex;
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, unsigned int> ids;
+    };
+
+    SymbolTable& table()
+    {
+        static SymbolTable symbols;
+        return symbols;
+    }
+};
+
+
+// =============================================Symbol=============================================
+Symbol::Symbol(std::string_view name): id(table().intern(name)) { }
+
+std::optional<Symbol> Symbol::find(std::string_view name)
+{
+    auto found = table().find(name);
+    return found? std::optional<Symbol>(Symbol(*found)) : std::nullopt;
+}
+
+std::string_view Symbol::str() const { return table().str(id); }
+
+std::ostream& var::operator<<(std::ostream& stream, const Symbol &symbol) { return stream << symbol.str(); }
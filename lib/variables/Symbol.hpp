@@ -0,0 +1,57 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+#include <string>
+#include <string_view>
+#include <optional>
+#include <iostream>
+#include <functional>
+#include <compare>
+#include <cstdint>
+
+
+namespace var {
+// interned name (variable names, map keys). one table is shared by the whole process so the same name
+// always gets the same id. comparing/hashing a Symbol only touches the id
+class Symbol
+{
+    public:
+        Symbol(): id(0) {} // empty string
+        explicit Symbol(std::string_view name);
+        explicit Symbol(const std::string &name): Symbol(std::string_view(name)) {}
+        explicit Symbol(const char* name): Symbol(std::string_view(name)) {}
+
+        // returns nullopt instead of interning if name has never been seen
+        static std::optional<Symbol> find(std::string_view name);
+
+        std::string_view str() const;
+        unsigned int getId() const { return id; }
+        bool empty() const { return id == 0; }
+
+        bool operator==(const Symbol &other) const { return id == other.id; }
+        std::strong_ordering operator<=>(const Symbol &other) const { return id <=> other.id; }
+    private:
+        explicit Symbol(unsigned int anId): id(anId) {}
+        unsigned int id;
+};
+std::ostream& operator<<(std::ostream& stream, const Symbol &symbol);
+
+// where a name was resolved to when the rules were loaded (EnvironmentManager::resolve): the scope depth levels
+// in from the global scope (0) and the name's slot in it. unresolved names are looked up by name
+struct SlotRef
+{
+    static constexpr uint16_t none = UINT16_MAX;
+    uint16_t depth = none;
+    uint16_t index = none;
+
+    bool resolved() const { return depth != none; }
+    bool operator==(const SlotRef &other) const = default;
+};
+};
+
+template<>
+struct std::hash<var::Symbol>
+{
+    size_t operator()(const var::Symbol &symbol) const noexcept { return symbol.getId(); }
+};
+
+#endif
@@ -0,0 +1,175 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+
+using namespace env_mgr;
+
+
+TimerWheel::TimerWheel(clock::time_point start): epoch(start)
+{
+    heads.fill(npos);
+    tails.fill(npos);
+}
+
+uint64_t TimerWheel::tickOf(clock::time_point time) const
+{
+    auto ticks = std::chrono::duration_cast<std::chrono::milliseconds>(time - epoch).count();
+    return ticks < 0? 0 : ticks;
+}
+
+// slots in a level are picked by the expiry's own bits, so a level's slot comes around exactly when the expiry
+// moves into the level below
+uint32_t TimerWheel::slotFor(uint64_t expire) const
+{
+    uint64_t delta = std::min(expire - std::min(expire, current), maxDelta - 1);
+    uint64_t placeAt = current + delta; // too far out: park in the last level, cascading puts it back in order
+    if(delta < ((uint64_t) 1 << rootBits))
+    { return placeAt & ((1 << rootBits) - 1); }
+
+    for(unsigned level = 1; level < levels; level++)
+    {
+        unsigned shift = rootBits + levelBits * level;
+        if(delta < ((uint64_t) 1 << shift) || level == levels - 1)
+        {
+            unsigned index = (placeAt >> (shift - levelBits)) & ((1 << levelBits) - 1);
+            return (1 << rootBits) + (level - 1) * (1 << levelBits) + index;
+        }
+    }
+    return npos; // unreachable
+}
+
+unsigned TimerWheel::levelOf(uint32_t slot)
+{ return slot < (1 << rootBits)? 0 : 1 + ((slot - (1 << rootBits)) >> levelBits); }
+
+void TimerWheel::link(uint32_t index)
+{
+    Entry &entry = entries[index];
+    entry.slot = slotFor(entry.expire);
+    levelCounts[levelOf(entry.slot)]++;
+    entry.next = npos;
+    entry.prev = tails[entry.slot];
+    if(entry.prev == npos) { heads[entry.slot] = index; }
+    else { entries[entry.prev].next = index; }
+    tails[entry.slot] = index;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Entry &entry = entries[index];
+    levelCounts[levelOf(entry.slot)]--;
+    if(entry.prev == npos) { heads[entry.slot] = entry.next; }
+    else { entries[entry.prev].next = entry.next; }
+    if(entry.next == npos) { tails[entry.slot] = entry.prev; }
+    else { entries[entry.next].prev = entry.prev; }
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Entry &entry = entries[index];
+    entry.slot = npos;
+    entry.generation++; // old ids for this entry stop matching
+    entry.next = freeList;
+    freeList = index;
+    count--;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(int owner, int timer, std::chrono::milliseconds delay, clock::time_point now)
+{
+    std::lock_guard lock(mutex);
+    uint32_t index = freeList;
+    if(index == npos)
+    {
+        index = entries.size();
+        entries.emplace_back();
+    }
+    else { freeList = entries[index].next; }
+
+    Entry &entry = entries[index];
+    // the current tick has been fired already, so the soonest a timer can go off is the next one
+    entry.expire = std::max(tickOf(now) + std::max<int64_t>(delay.count(), 0), current + 1);
+    entry.owner = owner;
+    entry.timer = timer;
+    link(index);
+    count++;
+    return ((TimerId) entry.generation << 32 | index) + 1;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    std::lock_guard lock(mutex);
+    if(id == 0)
+    { return false; }
+    uint32_t index = (id - 1) & UINT32_MAX;
+    if(index >= entries.size() || entries[index].slot == npos || entries[index].generation != (id - 1) >> 32)
+    { return false; }
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+void TimerWheel::cascade(unsigned level)
+{
+    unsigned shift = rootBits + levelBits * (level - 1);
+    uint32_t slot = (1 << rootBits) + (level - 1) * (1 << levelBits) + ((current >> shift) & ((1 << levelBits) - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = tails[slot] = npos;
+    while(index != npos)
+    {
+        uint32_t next = entries[index].next;
+        levelCounts[level]--;
+        link(index);
+        index = next;
+    }
+}
+
+std::vector<TimerWheel::Fired> TimerWheel::advance(clock::time_point now)
+{
+    std::lock_guard lock(mutex);
+    std::vector<Fired> fired;
+    uint64_t target = tickOf(now);
+    while(current < target)
+    {
+        if(count == 0) // nothing to cascade or fire
+        {
+            current = target;
+            break;
+        }
+        // nothing fires until the lowest non empty level cascades, so go straight to the tick before that
+        unsigned empty = 0;
+        while(empty < levels - 1 && levelCounts[empty] == 0) { empty++; }
+        if(empty > 0)
+        {
+            uint64_t span = (uint64_t) 1 << (rootBits + levelBits * (empty - 1));
+            current = std::max(current, std::min(target, (current | (span - 1)) + 1) - 1);
+        }
+        current++;
+
+        // when a level wraps, the next slot of the level above comes due and is spread over the levels below
+        for(unsigned level = 1; level < levels; level++)
+        {
+            if((current & (((uint64_t) 1 << (rootBits + levelBits * (level - 1))) - 1)) != 0)
+            { break; }
+            cascade(level);
+        }
+
+        uint32_t slot = current & ((1 << rootBits) - 1);
+        uint32_t index = heads[slot];
+        heads[slot] = tails[slot] = npos;
+        while(index != npos)
+        {
+            uint32_t next = entries[index].next;
+            fired.push_back({entries[index].owner, entries[index].timer});
+            levelCounts[0]--;
+            release(index);
+            index = next;
+        }
+    }
+    return fired;
+}
+
+size_t TimerWheel::size() const
+{
+    std::lock_guard lock(mutex);
+    return count;
+}
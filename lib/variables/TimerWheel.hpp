@@ -0,0 +1,75 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace env_mgr
+{
+    // hierarchical timer wheel with 1ms ticks, shared by every game on a server (owned by GameInstanceManager).
+    // schedule/cancel are O(1), advance() only touches the slots that come due, and reports which owner's
+    // (game instance id) timers fired so only those games have to be woken.
+    // levels: 256 x 1ms, then 64 x 256ms, 64 x ~16s, 64 x ~17min. timers further out than ~18h sit in the last level
+    // and are moved down as it turns. thread safe
+    class TimerWheel
+    {
+        public:
+            using clock = std::chrono::steady_clock;
+            using TimerId = uint64_t; // 0 is never a valid id
+
+            struct Fired
+            {
+                int owner;
+                int timer;
+                bool operator==(const Fired &other) const = default;
+            };
+
+            TimerWheel(clock::time_point start = clock::now());
+            TimerWheel(const TimerWheel&) = delete;
+
+            TimerId schedule(int owner, int timer, std::chrono::milliseconds delay, clock::time_point now = clock::now());
+            bool cancel(TimerId id); // false if it already fired or was cancelled
+            // fires everything due by now, in expiry order (same tick: schedule order)
+            std::vector<Fired> advance(clock::time_point now = clock::now());
+
+            size_t size() const;
+        private:
+            static constexpr uint32_t npos = UINT32_MAX;
+            static constexpr unsigned rootBits = 8, levelBits = 6, levels = 4;
+            static constexpr uint64_t maxDelta = (uint64_t) 1 << (rootBits + levelBits * (levels - 1));
+
+            struct Entry
+            {
+                uint64_t expire = 0; // tick
+                int owner = 0;
+                int timer = 0;
+                uint32_t prev = npos;
+                uint32_t next = npos;
+                uint32_t slot = npos; // npos if free
+                uint32_t generation = 0;
+            };
+
+            uint64_t tickOf(clock::time_point time) const;
+            uint32_t slotFor(uint64_t expire) const;
+            static unsigned levelOf(uint32_t slot);
+            void link(uint32_t index);
+            void unlink(uint32_t index);
+            void release(uint32_t index);
+            void cascade(unsigned level);
+
+            const clock::time_point epoch;
+            uint64_t current = 0; // last tick processed
+            size_t count = 0;
+            std::array<size_t, levels> levelCounts{}; // lets advance() skip over ticks where nothing can happen
+            std::vector<Entry> entries; // slab, free ones chained through next
+            uint32_t freeList = npos;
+            // level 0 slots then 64 per higher level. heads/tails of each slot's list so a slot fires in order
+            std::array<uint32_t, (1 << rootBits) + (levels - 1) * (1 << levelBits)> heads, tails;
+            mutable std::mutex mutex;
+    };
+};
+
+#endif
@@ -1,7 +1,11 @@
 #include "Variables.hpp"
 #include <sstream>
 #include <algorithm>
-#include <random>
+#include <atomic>
+#include <numeric>
+#include <utility>
+#include <future>
+#include <thread>
 
 using namespace var;
 template<class... Ts> struct overload : Ts... { using Ts::operator()...; };
@@ -15,48 +19,136 @@ void debugPrint(const std::string_view &msg)
     #endif
 }
 
+// memory resource
+thread_local std::pmr::memory_resource* currMemoryResource = std::pmr::new_delete_resource();
+
+std::pmr::memory_resource* var::memoryResource() { return currMemoryResource; }
+MemoryResourceGuard::MemoryResourceGuard(std::pmr::memory_resource* resource): prev(currMemoryResource)
+{ currMemoryResource = resource ? resource : std::pmr::new_delete_resource(); }
+MemoryResourceGuard::~MemoryResourceGuard() { currMemoryResource = prev; }
+
+std::shared_ptr<std::pmr::memory_resource> GameArena::create()
+{
+    // the shared_ptr is the game's reference, not the only one
+    return std::shared_ptr<std::pmr::memory_resource>(new GameArena(),
+        [](std::pmr::memory_resource* arena) { static_cast<GameArena*>(arena)->release(); });
+}
+
+// threads take versions from the shared counter in blocks, so making a Variable doesn't touch the atomic
+uint64_t var::nextVersion()
+{
+    static std::atomic<uint64_t> blocks{0};
+    constexpr uint64_t blockSize = 1 << 16;
+    thread_local uint64_t next = 0, end = 0;
+    if(next == end)
+    {
+        next = blocks.fetch_add(1, std::memory_order_relaxed) * blockSize + 1;
+        end = next + blockSize;
+    }
+    return next++;
+}
+
 // variable class
-bool Variable::operator==(const Variable &var) const { return var.isEqual(*value); }
+bool Variable::operator==(const Variable &var) const { return var.isEqual(value); }
 void Variable::set(const varType &val)
 {
     varType temp(val);
-    VariableUtils::setValue(*value, temp);
+    VariableUtils::setValue(value, temp);
+    touch();
 }
 void Variable::set(const varType &val, const varType &val2)
 {
     varType temp(val);
     varType temp2(val2);
-    VariableUtils::setValue(*value, temp, temp2);
+    VariableUtils::setValue(value, temp, temp2);
+    touch();
 }
 void Variable::set(const varType &val, Variable &val2)
 {
     varType temp(val);
-    VariableUtils::setValue(*value, temp, val2);
+    VariableUtils::setValue(value, temp, val2);
+    touch();
 }
 std::string Variable::get(const varType &key)
 {
     varType temp(key);
-    return VariableUtils::getWithKey(*value, temp);
+    return VariableUtils::getWithKey(value, temp);
+}
+void Variable::print() { VariableUtils::printValue(value); }
+Type Variable::type() { return VariableUtils::getType(value); }
+bool Variable::isEqual(const varType &other) const { return VariableUtils::compare(value, other); }
+bool Variable::isEqual(Variable &other) const { return isEqual(other.getRef()); }
+size_t Variable::size() const { return VariableUtils::size(value); }
+
+VariableIndex::VariableIndex(const listObj &list)
+{
+    versions.reserve(list.size());
+    items.reserve(list.size());
+    for(const auto &item : list)
+    {
+        versions.emplace_back(item.get(), item? item->version() : 0);
+        if(item) { items.emplace(VariableUtils::hash(item->getRef()), item.get()); }
+    }
+}
+bool VariableIndex::current(const listObj &list) const
+{
+    return versions.size() == list.size() &&
+        std::equal(versions.begin(), versions.end(), list.begin(), [](const auto &entry, const auto &item)
+        { return entry.first == item.get() && (!item || item->version() == entry.second); });
+}
+bool VariableIndex::contains(const varType &item) const
+{
+    auto [first, last] = items.equal_range(VariableUtils::hash(item));
+    return std::any_of(first, last, [&item](const auto &entry)
+    { return entry.second->getRef().index() == item.index() && entry.second->isEqual(item); });
+}
+
+std::shared_ptr<varType> var::valuePtr(const std::shared_ptr<Variable> &var)
+{
+    if(!var) { return nullptr; }
+    return std::shared_ptr<varType>(var, var->getBorrowPtr()); // aliasing ctor: shares var's control block
 }
-void Variable::print() { VariableUtils::printValue(*value); }
-Type Variable::type() { return VariableUtils::getType(*value); }
-bool Variable::isEqual(const varType &other) const { return VariableUtils::compare(*value, other); }
-bool Variable::isEqual(Variable &other) const { return isEqual(other.get()); }
-size_t Variable::size() const { return VariableUtils::size(*value); }
 
 
 // variable functions
 void VariableUtils::setValue(varType &var, varType &val)
 {
-    if(var.index() != val.index())
+    if(var.index() != val.index() && !(ListObjUtils::isList(var) && ListObjUtils::isList(val))) // any list kind can replace a list
     {
         throw BadVariableArgException();
         return;
     }
     var = val;
 }
+// var[index] = value for typed lists, converting var to a listObj if value isn't the element type.
+// returns false if var isn't a typed list
+bool setTypedValue(varType &var, const varType &indx, const varType &value)
+{
+    auto index = std::get_if<int>(&indx);
+    if(index == nullptr || std::holds_alternative<listObj>(var) || !ListObjUtils::isList(var))
+    { return false; }
+
+    auto intItem = std::get_if<int>(&value);
+    auto stringItem = std::get_if<std::string>(&value);
+    auto ints = std::get_if<intList>(&var);
+    auto strings = std::get_if<stringList>(&var);
+    if(ints != nullptr && intItem != nullptr)
+    { ints->at(*index) = *intItem; }
+    else if(strings != nullptr && stringItem != nullptr)
+    { strings->at(*index) = *stringItem; }
+    else
+    {
+        ListObjUtils::expand(var);
+        listObj &list = std::get<listObj>(var);
+        list.at(*index) = allocateVar(list.get_allocator(), value);
+    }
+    return true;
+}
 void VariableUtils::setValue(varType &var, varType &val, Variable &val2)
 {
+    if(setTypedValue(var, val, val2.getRef()))
+    { return; }
+
     varMapType* map;
     listObj* list;
     std::string* key;
@@ -64,13 +156,13 @@ void VariableUtils::setValue(varType &var, varType &val, Variable &val2)
     if ((map = std::get_if<varMapType>(&var)) != nullptr &&
         (key = std::get_if<std::string>(&val)) != nullptr)
     {
-        (*map)[*key] = std::make_shared<Variable>(val2);
+        (*map)[Symbol(*key)] = allocateVar(map->get_allocator(), val2);
         return;
     }
     else if ((list = std::get_if<listObj>(&var)) != nullptr &&
         (index = std::get_if<int>(&val)) != nullptr)
     {
-        list->at(*index) = std::shared_ptr<Variable>(&val2);
+        list->at(*index) = allocateVar(list->get_allocator(), val2);
         return;
     }
     throw BadVariableArgException("Expected mapType, string, string");
@@ -78,6 +170,9 @@ void VariableUtils::setValue(varType &var, varType &val, Variable &val2)
 
 void VariableUtils::setValue(varType &var, varType &val, varType &val2)
 {
+    if(setTypedValue(var, val, val2))
+    { return; }
+
     listObj* list;
     int* index;
     mapType* orig;
@@ -87,13 +182,14 @@ void VariableUtils::setValue(varType &var, varType &val, varType &val2)
         (key = std::get_if<std::string>(&val)) != nullptr &&
         (value = std::get_if<std::string>(&val2)) != nullptr)
     {
-        (*orig)[*key] = std::make_shared<std::string>(*value);
+        GameAllocator<std::string> alloc(orig->get_allocator());
+        (*orig)[Symbol(*key)] = std::allocate_shared<std::string>(alloc, *value);
         return;
     }
     else if ((list = std::get_if<listObj>(&var)) != nullptr &&
             (index = std::get_if<int>(&val)) != nullptr)
     {
-        list->at(*index) = std::make_shared<Variable>(val2);
+        list->at(*index) = allocateVar(list->get_allocator(), val2);
         return;
     }
     throw BadVariableArgException("Expected mapType, string, string");
@@ -103,9 +199,11 @@ void VariableUtils::printValue(const varType &var, std::string_view delim, std::
 {
     if (auto val = std::get_if<mapType>(&var))
     {
-        std::for_each(val->begin(), val->end(), [&stream](const auto &item)
+        // sorted by name so output doesn't depend on insertion order
+        auto items = ordered(*val, [](const Symbol &a, const Symbol &b) { return a.str() < b.str(); });
+        std::for_each(items.begin(), items.end(), [&stream](const auto *item)
         {
-            stream << "[" << item.first << "] = " << item.second;
+            stream << "[" << item->first << "] = " << item->second;
         });
     }
     else if (auto val = std::get_if<listObj>(&var))
@@ -115,6 +213,18 @@ void VariableUtils::printValue(const varType &var, std::string_view delim, std::
             VariableUtils::printValue(item->get(), ", ", stream);
         });
     }
+    else if (auto val = std::get_if<intList>(&var))
+    {
+        std::for_each(val->begin(), val->end(), [&stream](int item) { stream << item << ", "; });
+    }
+    else if (auto val = std::get_if<stringList>(&var))
+    {
+        std::for_each(val->begin(), val->end(), [&stream](const auto &item) { stream << item << ", "; });
+    }
+    else if (auto val = std::get_if<deckObj>(&var))
+    {
+        for (size_t i = 0; i < val->size(); i++) { stream << val->card(i).name << ", "; }
+    }
     else if (auto val = std::get_if<int>(&var) ) { stream << *val; }
     else if (auto val = std::get_if<std::string>(&var) ) { stream << *val; }
     else if (auto val = std::get_if<bool>(&var) ) { stream << *val; }
@@ -129,6 +239,19 @@ Type VariableUtils::getType(const varType &var)
 
 bool VariableUtils::compare(const varType &var1, const varType &var2)
 {
+    // a typed list equals a listObj holding the same values
+    if(var1.index() != var2.index() && ListObjUtils::isList(var1) && ListObjUtils::isList(var2))
+    {
+        varType list1(var1);
+        varType list2(var2);
+        ListObjUtils::expand(list1);
+        ListObjUtils::expand(list2);
+        const listObj &items1 = std::get<listObj>(list1);
+        const listObj &items2 = std::get<listObj>(list2);
+        return items1.size() == items2.size() &&
+            std::equal(items1.begin(), items1.end(), items2.begin(),
+                [](const auto &item1, const auto &item2) { return item1->getRef() == item2->getRef(); });
+    }
     if(var1.index() != var2.index())
     {
         throw BadVariableArgException("Expected arguments t be same type");
@@ -138,61 +261,101 @@ bool VariableUtils::compare(const varType &var1, const varType &var2)
     // handle lists separately
     if(auto list1 = std::get_if<listObj>(&var1))
     {
-        if(auto list2 = std::get_if<listObj>(&var1))
-        {
-            return std::equal(list1->begin(), list1->end(), list2->begin(),
+        const listObj &list2 = std::get<listObj>(var2);
+        return list1->size() == list2.size() &&
+            std::equal(list1->begin(), list1->end(), list2.begin(),
                 [](const auto&item1, const auto& item2)
                 {
-                    return item1->isEqual(item2->getRef());
+                    // lists can be mixed, items of different types aren't equal
+                    return item1->getRef().index() == item2->getRef().index() && item1->isEqual(item2->getRef());
                 });
-        }
     }
     return var1 == var2;
 }
+
+namespace
+{
+    size_t hashCombine(size_t seed, size_t value)
+    { return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)); }
+
+    template <typename List, typename Hash>
+    size_t hashList(const List &list, Hash &&hashItem)
+    {
+        size_t seed = list.size();
+        for(const auto &item : list) { seed = hashCombine(seed, hashItem(item)); }
+        return seed;
+    }
+
+    // map values compare by pointer (see CowMap ==), entries are combined so that order doesn't matter
+    template <typename Map>
+    size_t hashMap(const Map &map)
+    {
+        size_t seed = map.size();
+        for(const auto &[key, value] : map)
+        { seed += hashCombine(std::hash<Symbol>()(key), std::hash<typename Map::mapped_type>()(value)); }
+        return seed;
+    }
+}
+
+size_t VariableUtils::hash(const varType &var)
+{
+    // lists hash their values, not the list kind, since an intList equals a listObj with the same values
+    return std::visit(overload{
+        [](const listObj &list) { return hashList(list, [](const auto &item) { return item? hash(item->getRef()) : 0; }); },
+        [](const intList &list) { return hashList(list, std::hash<int>()); },
+        [](const stringList &list) { return hashList(list, std::hash<std::string>()); },
+        [](const deckObj &deck) { return hashList(deck, std::hash<uint8_t>()); },
+        [](const mapType &map) { return hashMap(map); },
+        [](const varMapType &map) { return hashMap(map); },
+        [](const std::monostate&) { return (size_t) 0; },
+        [](const auto &value) { return std::hash<std::decay_t<decltype(value)>>()(value); } // int, string, bool, pointer
+    }, var);
+}
+
 std::string VariableUtils::getWithKey(varType &var1, const varType &key)
+{
+    return std::string(viewWithKey(var1, key));
+}
+std::string_view VariableUtils::viewWithKey(const varType &var1, const varType &key)
 {
     if (auto a = std::get_if<mapType>(&var1))
     {
         if(auto b = std::get_if<std::string>(&key))
         {
-            // return *(a->at(*b));
-            auto it = *(a->find(*b));
-            if(it != *(a->end()))
-            {
-                return *it.second;
-            }
-            else
-            {
-                return "";
-            }
+            auto symbol = Symbol::find(*b);
+            auto it = symbol? a->find(*symbol) : a->end();
+            return it != a->end()? std::string_view(*it->second) : std::string_view();
         }
     }
-    throw BadVariableArgException("Expected mapType, string");
-    return "";
+    else if (auto deck = std::get_if<deckObj>(&var1))
+    {
+        // name of the card at index
+        if(auto index = std::get_if<int>(&key))
+        {
+            int tempIndex = *index < 0? deck->size() + *index : *index;
+            return tempIndex >= 0 && (size_t)tempIndex < deck->size()? std::string_view(deck->card(tempIndex).name) : std::string_view();
+        }
+    }
+    throw BadVariableArgException("Expected mapType, string or deckObj, int");
+    return {};
 }
 std::shared_ptr<Variable> VariableUtils::getVarWithKey(varType &var1, const varType &key)
 {
     varMapType* map;
     const std::string* mapKey;
     const int* index;
-    listObj* list;
     if((map = std::get_if<varMapType>(&var1)) != nullptr &&
         (mapKey = std::get_if<std::string>(&key)) != nullptr)
     {
-        // return map->at(*mapKey);
-        auto it = map->find(*mapKey);
-        if(it != map->end())
-        {
-            return it->second;
-        }
-        else
-        {
-            return nullptr;
-        }
+        // a key that was never interned can't be in any map
+        auto symbol = Symbol::find(*mapKey);
+        return symbol? getVarWithKey(var1, *symbol) : nullptr;
     }
-    else if((list = std::get_if<listObj>(&var1)) != nullptr &&
+    else if(ListObjUtils::isList(var1) &&
         (index = std::get_if<int>(&key)) != nullptr)
     {
+        // typed list and deck elements are plain values, a Variable handed out for one would be a detached copy
+        if(!std::holds_alternative<listObj>(var1)) { ListObjUtils::expand(var1); }
         return ListObjUtils::get_at(var1, key);
     }
 
@@ -200,6 +363,45 @@ std::shared_ptr<Variable> VariableUtils::getVarWithKey(varType &var1, const varT
     return nullptr;
 }
 
+std::shared_ptr<Variable> VariableUtils::getVarWithKey(const varType &var1, const Symbol &key)
+{
+    if(const varMapType* map = std::get_if<varMapType>(&var1)) // const so a shared map isn't copied
+    {
+        auto it = map->find(key);
+        return it == map->end()? nullptr : it->second;
+    }
+    throw BadVariableArgException("Expected varMapType, Symbol");
+    return nullptr;
+}
+Variable* VariableUtils::borrowVarWithKey(const varType &var1, const varType &key)
+{
+    const int* index;
+    if(auto mapKey = std::get_if<std::string>(&key); mapKey != nullptr && std::holds_alternative<varMapType>(var1))
+    {
+        auto symbol = Symbol::find(*mapKey);
+        return symbol? borrowVarWithKey(var1, *symbol) : nullptr;
+    }
+    else if(auto list = std::get_if<listObj>(&var1); list != nullptr && (index = std::get_if<int>(&key)) != nullptr)
+    {
+        int tempIndex = *index < 0? list->size() + *index : *index;
+        return tempIndex >= 0 && (size_t)tempIndex < list->size()? (*list)[tempIndex].get() : nullptr;
+    }
+    else if(ListObjUtils::isList(var1) && std::holds_alternative<int>(key))
+    { throw BadVariableArgException("Elements of an intList, stringList or deckObj aren't Variables, use getVarWithKey or get_at"); }
+    throw BadVariableArgException("Expected mapType, string or listObj, int");
+    return nullptr;
+}
+Variable* VariableUtils::borrowVarWithKey(const varType &var1, const Symbol &key)
+{
+    if(auto map = std::get_if<varMapType>(&var1))
+    {
+        auto it = map->find(key);
+        return it == map->end()? nullptr : it->second.get();
+    }
+    throw BadVariableArgException("Expected varMapType, Symbol");
+    return nullptr;
+}
+
 size_t VariableUtils::size(const varType &var1)
 {
     if (auto a = std::get_if<listObj>(&var1))
@@ -214,23 +416,221 @@ size_t VariableUtils::size(const varType &var1)
     {
         return a->size();
     }
+    else if (auto a = std::get_if<intList>(&var1))
+    {
+        return a->size();
+    }
+    else if (auto a = std::get_if<stringList>(&var1))
+    {
+        return a->size();
+    }
+    else if (auto a = std::get_if<deckObj>(&var1))
+    {
+        return a->size();
+    }
     return sizeof(var1);
 }
 
 
 // list functions
+namespace
+{
+    // calls f(list) if var is an intList or stringList. returns false otherwise
+    template <typename Var, typename F>
+    bool visitTyped(Var &var, F &&f)
+    {
+        if (auto list = std::get_if<intList>(&var)) { f(*list); return true; }
+        if (auto list = std::get_if<stringList>(&var)) { f(*list); return true; }
+        return false;
+    }
 
-void ListObjUtils::shuffle(varType &var)
+    // runs op(list, item) if var is a typed list and val is its element type. if val is another type var is
+    // converted to listObj so the caller can carry on with the listObj version. returns true if op ran
+    template <typename Op>
+    bool typedOp(varType &var, const varType &val, Op &&op)
+    {
+        if (std::holds_alternative<deckObj>(var)) // only cards go in a deck
+        {
+            ListObjUtils::expand(var);
+            return false;
+        }
+        bool done = false;
+        bool typed = visitTyped(var, [&](auto &list)
+        {
+            using T = typename std::decay_t<decltype(list)>::value_type;
+            if (auto item = std::get_if<T>(&val))
+            {
+                op(list, *item);
+                done = true;
+            }
+        });
+        if (typed && !done) { ListObjUtils::expand(var); }
+        return done;
+    }
+
+    // branchless compare in fixed size blocks so the inner loop vectorizes, exits between blocks
+    bool linearContains(const int* data, size_t size, int key)
+    {
+        constexpr size_t block = 64;
+        size_t i = 0;
+        for (; i + block <= size; i += block)
+        {
+            bool found = false;
+            for (size_t j = i; j < i + block; j++) { found |= data[j] == key; }
+            if (found) { return true; }
+        }
+        for (; i < size; i++)
+        {
+            if (data[i] == key) { return true; }
+        }
+        return false;
+    }
+
+    std::shared_ptr<Variable> cardVar(const deckObj &deck, size_t index, GameAllocator<Variable> alloc)
+    {
+        const Card &card = deck.card(index);
+        varMapType map(alloc);
+        static const Symbol rank("rank"), suit("suit"), name("name");
+        map[rank] = allocateVar(alloc, card.rank);
+        map[suit] = allocateVar(alloc, card.suit);
+        map[name] = allocateVar(alloc, card.name);
+        return allocateVar(alloc, std::move(map));
+    }
+};
+
+bool ListObjUtils::isList(const varType &var)
+{
+    return std::holds_alternative<listObj>(var) || std::holds_alternative<deckObj>(var) || visitTyped(var, [](const auto&) {});
+}
+
+void ListObjUtils::compact(varType &var)
+{
+    auto list = std::get_if<listObj>(&var);
+    if (list == nullptr || list->empty() || list->isShared())
+    { return; }
+
+    const listObj &items = *list;
+    bool unshared = std::all_of(items.begin(), items.end(), [](const auto &item) { return item.use_count() == 1; });
+    auto type = VariableUtils::getType(items.front()->getRef());
+    bool sameType = std::all_of(items.begin(), items.end(),
+        [type](const auto &item) { return VariableUtils::getType(item->getRef()) == type; });
+    if (!unshared || !sameType || (type != Type::INT && type != Type::STRING))
+    { return; }
+
+    auto compactTo = [&var, &items](auto typed)
+    {
+        using T = typename decltype(typed)::value_type;
+        typed.reserve(items.size());
+        std::for_each(items.begin(), items.end(),
+            [&typed](const auto &item) { typed.push_back(std::get<T>(item->getRef())); });
+        var = std::move(typed);
+    };
+    type == Type::INT? compactTo(intList(items.get_allocator())) : compactTo(stringList(items.get_allocator()));
+}
+
+void ListObjUtils::expand(varType &var)
+{
+    if (auto deck = std::get_if<deckObj>(&var))
+    {
+        listObj list(deck->get_allocator());
+        list.reserve(deck->size());
+        for (size_t i = 0; i < deck->size(); i++) { list.push_back(cardVar(*deck, i, list.get_allocator())); }
+        var = std::move(list);
+        return;
+    }
+    visitTyped(var, [&var](const auto &typed)
+    {
+        listObj list(typed.get_allocator());
+        list.reserve(typed.size());
+        std::for_each(typed.begin(), typed.end(),
+            [&list](const auto &item) { list.push_back(allocateVar(list.get_allocator(), item)); });
+        var = std::move(list);
+    });
+}
+
+int ListObjUtils::sum(const varType &var)
+{
+    if (auto list = std::get_if<intList>(&var))
+    {
+        const int* data = list->data();
+        int total = 0;
+        for (size_t i = 0; i < list->size(); i++) { total += data[i]; } // vectorizes
+        return total;
+    }
+    else if (auto list = std::get_if<listObj>(&var))
+    {
+        return std::accumulate(list->begin(), list->end(), 0, [](int total, const auto &item)
+        {
+            if (auto val = std::get_if<int>(&item->getRef())) { return total + *val; }
+            throw BadVariableArgException("Expected list of ints");
+        });
+    }
+    throw BadVariableArgException("Expected list of ints");
+    return 0;
+}
+
+namespace
+{
+    // smallest (or largest if largest=true) element of a list of ints or strings
+    varType extreme(const varType &var, bool largest)
+    {
+        if (VariableUtils::size(var) == 0 || !ListObjUtils::isList(var))
+        { throw BadVariableArgException("Expected non empty list"); }
+
+        if (auto list = std::get_if<intList>(&var))
+        {
+            const int* data = list->data();
+            int result = data[0];
+            for (size_t i = 1; i < list->size(); i++) // vectorizes
+            { result = largest? std::max(result, data[i]) : std::min(result, data[i]); }
+            return result;
+        }
+        else if (auto list = std::get_if<stringList>(&var))
+        {
+            return largest? *std::max_element(list->begin(), list->end()) : *std::min_element(list->begin(), list->end());
+        }
+
+        const listObj &list = std::get<listObj>(var);
+        auto less = [](const auto &a, const auto &b)
+        {
+            auto intA = std::get_if<int>(&a->getRef());
+            auto intB = std::get_if<int>(&b->getRef());
+            if (intA != nullptr && intB != nullptr) { return *intA < *intB; }
+            auto strA = std::get_if<std::string>(&a->getRef());
+            auto strB = std::get_if<std::string>(&b->getRef());
+            if (strA != nullptr && strB != nullptr) { return *strA < *strB; }
+            throw BadVariableArgException("Expected list of ints or strings");
+        };
+        auto it = largest? std::max_element(list.begin(), list.end(), less) : std::min_element(list.begin(), list.end(), less);
+        if (list.size() == 1) { less(*it, *it); } // type check
+        return (*it)->get();
+    }
+};
+varType ListObjUtils::min(const varType &var) { return extreme(var, false); }
+varType ListObjUtils::max(const varType &var) { return extreme(var, true); }
+
+
+void ListObjUtils::shuffle(varType &var, Random &rng)
 {
-    std::random_device rd;
-    std::mt19937 g(rd());
     if (auto list = std::get_if<listObj>(&var))
     {
-        std::shuffle(list->begin(), list->end(), std::default_random_engine());
+        std::shuffle(list->begin(), list->end(), rng);
         return;
     }
+    else if (auto deck = std::get_if<deckObj>(&var))
+    {
+        std::shuffle(deck->begin(), deck->end(), rng); // one byte per card
+        return;
+    }
+    else if (visitTyped(var, [&rng](auto &list) { std::shuffle(list.begin(), list.end(), rng); }))
+    { return; }
     throw BadVariableArgException("Expected listObj as first arg");
 }
+void ListObjUtils::shuffle(varType &var)
+{
+    thread_local Random rng;
+    shuffle(var, rng);
+}
 
 void ListObjUtils::reverse(varType &var)
 {
@@ -239,15 +639,146 @@ void ListObjUtils::reverse(varType &var)
         std::reverse(list->begin(), list->end());
         return;
     }
+    else if (auto deck = std::get_if<deckObj>(&var))
+    {
+        std::reverse(deck->begin(), deck->end());
+        return;
+    }
+    else if (visitTyped(var, [](auto &list) { std::reverse(list.begin(), list.end()); }))
+    { return; }
     throw BadVariableArgException("Expected listObj as first arg");
 }
 
+namespace
+{
+    // sort key read from an element. string_views point into the list's elements, which outlive the sort
+    using sortKey = std::variant<bool, int, std::string_view, std::monostate>;
+
+    sortKey toSortKey(const varType &value)
+    {
+        if (auto val = std::get_if<bool>(&value)) { return *val; }
+        if (auto val = std::get_if<int>(&value)) { return *val; }
+        if (auto val = std::get_if<std::string>(&value)) { return std::string_view(*val); }
+        return std::monostate();
+    }
+
+    sortKey findSortKey(const varType &item, const std::vector<Symbol> &keyPath)
+    {
+        const varType* value = &item;
+        for (size_t i = 0; i < keyPath.size(); i++)
+        {
+            if (auto map = std::get_if<mapType>(value); map && i + 1 == keyPath.size())
+            {
+                auto it = map->find(keyPath[i]);
+                return (it == map->end() || !it->second)? sortKey(std::monostate()) : sortKey(std::string_view(*it->second));
+            }
+            Variable* next = std::holds_alternative<varMapType>(*value)? VariableUtils::borrowVarWithKey(*value, keyPath[i]) : nullptr;
+            if (next == nullptr) { return std::monostate(); }
+            value = &next->getRef();
+        }
+        return toSortKey(*value);
+    }
+
+    // above this many items the list is split into chunks sorted on their own threads, then merged
+    constexpr size_t parallelSortSize = 1 << 15;
+
+    // inplace_merge keeps equal items from the left run first, so the result is still stable
+    template <typename It, typename Comp>
+    void stableSort(It first, It last, Comp comp)
+    {
+        size_t size = last - first;
+        size_t chunks = std::min<size_t>(std::thread::hardware_concurrency(), size / (parallelSortSize / 2));
+        if (size < parallelSortSize || chunks < 2)
+        {
+            std::stable_sort(first, last, comp);
+            return;
+        }
+
+        std::vector<It> bounds;
+        for (size_t i = 0; i < chunks; i++) { bounds.push_back(first + size * i / chunks); }
+        bounds.push_back(last);
+
+        std::vector<std::future<void>> jobs;
+        for (size_t i = 0; i < chunks; i++)
+        { jobs.push_back(std::async(std::launch::async, [&bounds, &comp, i]() { std::stable_sort(bounds[i], bounds[i + 1], comp); })); }
+        for (auto &job : jobs) { job.get(); }
+
+        // merge neighbouring runs, doubling their width each round
+        for (size_t width = 1; width < chunks; width *= 2)
+        {
+            jobs.clear();
+            for (size_t i = 0; i + width < chunks; i += 2 * width)
+            {
+                It begin = bounds[i], middle = bounds[i + width], end = bounds[std::min(i + 2 * width, chunks)];
+                jobs.push_back(std::async(std::launch::async, [begin, middle, end, &comp]() { std::inplace_merge(begin, middle, end, comp); }));
+            }
+            for (auto &job : jobs) { job.get(); }
+        }
+    }
+}
+
+void ListObjUtils::sort(varType &var, const std::vector<Symbol> &keyPath)
+{
+    if (auto deck = std::get_if<deckObj>(&var))
+    {
+        // codes are in table order. a key sorts by that card attribute, read from the table once per code
+        if (keyPath.empty())
+        {
+            std::stable_sort(deck->begin(), deck->end());
+            return;
+        }
+        if (keyPath.size() != 1 || !deck->table())
+        { throw BadVariableArgException("Expected rank, suit or name to sort a deck by"); }
+
+        static const Symbol rank("rank"), suit("suit"), name("name");
+        const CardTable &table = *deck->table();
+        std::vector<sortKey> keys(table.size());
+        for (size_t code = 0; code < table.size(); code++)
+        {
+            const Card &card = table[code];
+            if (keyPath[0] == rank) { keys[code] = card.rank; }
+            else if (keyPath[0] == suit) { keys[code] = std::string_view(card.suit); }
+            else if (keyPath[0] == name) { keys[code] = std::string_view(card.name); }
+            else { throw BadVariableArgException("Expected rank, suit or name to sort a deck by"); }
+        }
+        std::stable_sort(deck->begin(), deck->end(), [&keys](uint8_t a, uint8_t b) { return keys[a] < keys[b]; });
+        return;
+    }
+
+    if (visitTyped(var, [&keyPath](auto &list)
+        {
+            if (!keyPath.empty()) { throw BadVariableArgException("Expected a list of maps to sort by key"); }
+            stableSort(list.begin(), list.end(), std::less<>());
+        }))
+    { return; }
+
+    auto list = std::get_if<listObj>(&var);
+    if (list == nullptr)
+    { throw BadVariableArgException("Expected listObj as first arg"); }
+
+    // decorate-sort-undecorate: keys are looked up once into one array, the sort only moves (key, index) pairs
+    const listObj &items = *list;
+    std::vector<std::pair<sortKey, size_t>> keys;
+    keys.reserve(items.size());
+    for (size_t i = 0; i < items.size(); i++)
+    { keys.emplace_back(findSortKey(items[i]->getRef(), keyPath), i); }
+
+    stableSort(keys.begin(), keys.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    std::vector<std::shared_ptr<Variable>> unsorted(std::make_move_iterator(list->begin()), std::make_move_iterator(list->end()));
+    for (size_t i = 0; i < keys.size(); i++)
+    { (*list)[i] = std::move(unsorted[keys[i].second]); }
+}
 
 void ListObjUtils::push_back(varType &var, const varType &val)
 {
+    if (typedOp(var, val, [](auto &list, const auto &item) { list.push_back(item); }))
+    { return; }
+
     if (auto list = std::get_if<listObj>(&var))
     {
-        list->push_back(std::make_shared<Variable>(val));
+        // elements live in the same resource as their list
+        list->push_back(allocateVar(list->get_allocator(), val));
         return;
     }
     throw BadVariableArgException("Expected listObj as first arg");
@@ -256,22 +787,92 @@ void ListObjUtils::push_back(varType &var, const varType &val)
 
 void ListObjUtils::remove(varType &var, const varType &val)
 {
-    if (auto vec = std::get_if<listObj>(&var))
+    auto numToDelete = std::get_if<int>(&val);
+    if (numToDelete == nullptr || !isList(var))
+    { throw BadVariableArgException("expected listObj, int"); }
+    if (*numToDelete <= 0) { return; }
+
+    if (auto vec = std::get_if<listObj>(&var)) { vec->erase_front(*numToDelete); }
+    else if (auto deck = std::get_if<deckObj>(&var)) { deck->erase_front(*numToDelete); }
+    else { visitTyped(var, [numToDelete](auto &list) { list.erase_front(*numToDelete); }); }
+}
+
+namespace
+{
+    // appends the first count items of from to to, moving them if from's storage isn't shared
+    template <typename List>
+    void moveFront(List &from, List &to, size_t count)
     {
-        if(auto numToDelete = std::get_if<int>(&val))
+        if (from.isShared())
         {
-            if(*numToDelete < 0) { return; }
-            unsigned uNumToDelete = *numToDelete; // silence warnings
-            if(uNumToDelete <= vec->size())
-            {
-                vec->erase(vec->begin(),vec->begin() + *numToDelete);
-            }
+            const List &source = from; // reading doesn't detach
+            to.insert(to.end(), source.begin(), source.begin() + count);
         }
+        else
+        { to.insert(to.end(), std::make_move_iterator(from.begin()), std::make_move_iterator(from.begin() + count)); }
+        from.erase_front(count);
     }
-    throw BadVariableArgException("expected listObj, int");
 }
 
-void insert_helper(listObj &vec, const Variable &var, const int &index)
+void ListObjUtils::deal(varType &from, varType &to, const varType &count)
+{
+    auto numToDeal = std::get_if<int>(&count);
+    if (numToDeal == nullptr || !isList(from) || !isList(to))
+    { throw BadVariableArgException("expected listObj, listObj, int"); }
+    if (*numToDeal <= 0) { return; }
+    size_t num = std::min<size_t>(*numToDeal, VariableUtils::size(from));
+
+    if (&from == &to) // front to back of the same list
+    {
+        if (auto vec = std::get_if<listObj>(&from)) { std::rotate(vec->begin(), vec->begin() + num, vec->end()); }
+        else if (auto deck = std::get_if<deckObj>(&from)) { std::rotate(deck->begin(), deck->begin() + num, deck->end()); }
+        else { visitTyped(from, [num](auto &list) { std::rotate(list.begin(), list.begin() + num, list.end()); }); }
+        return;
+    }
+
+    // deck to deck copies codes. an empty deck takes on the table of the cards dealt to it
+    auto fromDeck = std::get_if<deckObj>(&from);
+    auto toDeck = std::get_if<deckObj>(&to);
+    if (fromDeck && toDeck && (toDeck->table() == nullptr || fromDeck->table() == nullptr ||
+        *toDeck->table() == *fromDeck->table()))
+    {
+        if (toDeck->table() == nullptr) { toDeck->setTable(fromDeck->table()); }
+        const deckObj &source = *fromDeck;
+        toDeck->append(source.begin(), source.begin() + num);
+        fromDeck->erase_front(num);
+        return;
+    }
+    if (fromDeck) // cards become varMapTypes
+    {
+        expand(to);
+        listObj &dest = std::get<listObj>(to);
+        for (size_t i = 0; i < num; i++) { dest.push_back(cardVar(*fromDeck, i, dest.get_allocator())); }
+        fromDeck->erase_front(num);
+        return;
+    }
+
+    // different kinds of list: the values have to live in Variables on the receiving side
+    if (from.index() != to.index()) { expand(to); }
+
+    if (auto vec = std::get_if<listObj>(&from))
+    { moveFront(*vec, std::get<listObj>(to), num); }
+    else if (from.index() == to.index())
+    { visitTyped(from, [&to, num](auto &list) { moveFront(list, std::get<std::decay_t<decltype(list)>>(to), num); }); }
+    else
+    {
+        listObj &dest = std::get<listObj>(to);
+        visitTyped(from, [&dest, num](auto &list)
+        {
+            const auto &source = list;
+            std::for_each(source.begin(), source.begin() + num,
+                [&dest](const auto &item) { dest.push_back(allocateVar(dest.get_allocator(), item)); });
+            list.erase_front(num);
+        });
+    }
+}
+
+template <typename List>
+void insert_helper(List &vec, const typename List::value_type &item, const int &index)
 {
     int tempIndex = index;
     if(tempIndex < 0)
@@ -286,32 +887,30 @@ void insert_helper(listObj &vec, const Variable &var, const int &index)
     }
     unsigned int uIndex = tempIndex; // silence warnings
     auto it = uIndex == vec.size()? vec.end() : vec.begin() + uIndex;
-    vec.insert(it, std::make_shared<Variable>(var));
+    vec.insert(it, item);
 }
 void ListObjUtils::insert_at(varType &var, const varType &val, const varType &indx)
 {
+    auto index = std::get_if<int>(&indx);
+    if (index != nullptr && typedOp(var, val, [index](auto &list, const auto &item) { insert_helper(list, item, *index); }))
+    { return; }
+
     if (auto vec = std::get_if<listObj>(&var))
     {
-        if (auto index = std::get_if<int>(&indx))
+        if (index != nullptr)
         {
-            insert_helper(*vec, val, *index);
+            insert_helper(*vec, allocateVar(vec->get_allocator(), val), *index);
         }
     }
 }
 void ListObjUtils::insert_at(varType &var, const Variable &val, const varType &indx)
 {
-    if (auto vec = std::get_if<listObj>(&var))
-    {
-        if (auto index = std::get_if<int>(&indx))
-        {
-            insert_helper(*vec, val, *index);
-        }
-    }
+    insert_at(var, val.getRef(), indx);
 }
 
 void ListObjUtils::remove_at(varType &var, const varType &val)
 {
-    auto helper = [](listObj &vec, const int &index)
+    auto helper = [](auto &vec, const int &index)
     {
         int tempIndex = index;
         if(abs(tempIndex) > vec.size()) { return; }
@@ -322,61 +921,107 @@ void ListObjUtils::remove_at(varType &var, const varType &val)
         vec.erase(it);
     };
 
-    if (auto vec = std::get_if<listObj>(&var))
+    if (auto index = std::get_if<int>(&val))
     {
-        if (auto index = std::get_if<int>(&val))
+        if (auto vec = std::get_if<listObj>(&var))
         {
             helper(*vec, *index);
         }
+        else if (auto deck = std::get_if<deckObj>(&var))
+        {
+            helper(*deck, *index);
+        }
+        visitTyped(var, [&helper, index](auto &vec) { helper(vec, *index); });
     }
 }
 
+void ListObjUtils::push_back(Variable &var, const varType &val) { push_back(var.getRef(), val); var.touch(); }
+void ListObjUtils::remove(Variable &var, const varType &val) { remove(var.getRef(), val); var.touch(); }
+void ListObjUtils::deal(Variable &from, Variable &to, const varType &count)
+{
+    deal(from.getRef(), to.getRef(), count);
+    from.touch();
+    to.touch();
+}
+void ListObjUtils::insert_at(Variable &var, const varType &val, const varType &indx)
+{ insert_at(var.getRef(), val, indx); var.touch(); }
+void ListObjUtils::remove_at(Variable &var, const varType &val) { remove_at(var.getRef(), val); var.touch(); }
+void ListObjUtils::shuffle(Variable &var, Random &rng) { shuffle(var.getRef(), rng); var.touch(); }
+void ListObjUtils::reverse(Variable &var) { reverse(var.getRef()); var.touch(); }
+void ListObjUtils::sort(Variable &var, const std::vector<Symbol> &keyPath) { sort(var.getRef(), keyPath); var.touch(); }
+
 std::shared_ptr<Variable> ListObjUtils::get_at(varType &var1, const varType &key)
 {
     std::shared_ptr<Variable> temp;
-    auto helper = [&temp](listObj &vec, const int &index)
+    auto helper = [&temp](const auto &vec, const int &index)
     {
         int tempIndex = index;
         if(abs(tempIndex) > vec.size()) { return; }
         if(tempIndex < 0) { tempIndex = vec.size() + tempIndex; }
 
-        temp = vec.at(tempIndex);
+        if constexpr (std::is_same_v<std::decay_t<decltype(vec)>, listObj>)
+        { temp = vec.at(tempIndex); }
+        else if constexpr (std::is_same_v<std::decay_t<decltype(vec)>, deckObj>)
+        { temp = cardVar(vec, tempIndex, vec.get_allocator()); }
+        else // typed lists hold values, hand out a copy
+        { temp = allocateVar(vec.get_allocator(), vec.at(tempIndex)); }
     };
 
-    if (auto vec = std::get_if<listObj>(&var1))
+    if (auto index = std::get_if<int>(&key))
     {
-        if (auto index = std::get_if<int>(&key))
+        if (auto vec = std::get_if<listObj>(&var1))
         {
             helper(*vec, *index);
             return temp;
         }
+        else if (auto deck = std::get_if<deckObj>(&var1))
+        {
+            helper(*deck, *index);
+            return temp;
+        }
+        else if (visitTyped(std::as_const(var1), [&helper, index](const auto &vec) { helper(vec, *index); }))
+        {
+            return temp;
+        }
     }
 
     throw BadVariableArgException("Expected listObj, int");
     return temp;
 }
 
-bool ListObjUtils::contains(varType &var1, const varType &key)
+bool ListObjUtils::contains(const listObj &list, const varType &key)
 {
-    auto helper = [](listObj &vec, const auto &var)
+    if (list.size() >= listObj::indexThreshold)
+    { return list.getIndex().contains(key); }
+    return std::any_of(list.begin(), list.end(), [&key](const auto &item)
     {
-        varType temp(var);
-        return std::find_if(vec.begin(), vec.end(),
-        [&temp](const auto &item)
-        {
-            return item->isEqual(temp);
-        }) != vec.end();
-    };
-    if (auto vec = std::get_if<listObj>(&var1))
+        // lists can be mixed, compare() throws on different types
+        return item && item->getRef().index() == key.index() && item->isEqual(key);
+    });
+}
+
+bool ListObjUtils::contains(const varType &var1, const varType &key)
+{
+    // typed lists check their hash index once they're big enough (see CowList::getIndex)
+    if (auto vec = std::get_if<intList>(&var1))
     {
-        if (auto index = std::get_if<int>(&key))
-        {
-            return helper(*vec, *index);
-        }
-        else if (auto index = std::get_if<std::string>(&key))
-        {
-            return helper(*vec, *index);
-        }
+        auto index = std::get_if<int>(&key);
+        if (index == nullptr) { return false; }
+        return vec->size() < intList::indexThreshold? linearContains(vec->data(), vec->size(), *index) : vec->contains(*index);
+    }
+    else if (auto vec = std::get_if<stringList>(&var1))
+    {
+        auto index = std::get_if<std::string>(&key);
+        return index != nullptr && vec->contains(*index);
+    }
+    else if (auto deck = std::get_if<deckObj>(&var1)) // by card name
+    {
+        auto name = std::get_if<std::string>(&key);
+        return name != nullptr && deck->contains(*name);
+    }
+    else if (auto vec = std::get_if<listObj>(&var1))
+    {
+        return contains(*vec, key);
     }
     throw BadVariableArgException("Expected listObj as first arg");
     return false;
@@ -397,4 +1042,4 @@ listObj::iterator ListObjUtils::end(varType &var1)
         return vec->end();
     }
     return listObj::iterator{};
-}
\ No newline at end of file
+}
@@ -10,18 +10,101 @@
 #include <algorithm>
 #include <typeindex>
 #include <type_traits>
+#include <memory_resource>
+#include <atomic>
+#include <unordered_map>
 #include<random>
+#include "Symbol.hpp"
+#include "FlatMap.hpp"
+#include "CowContainer.hpp"
+#include "Deck.hpp"
+#include "Random.hpp"
 // dont print in release mode. define here so can be used in many classes
 void debugPrint(const std::string_view &msg);
 
 
 // Variable implementation
 namespace var {
+// memory resource that Variables and containers created on this thread allocate from.
+// new_delete_resource() unless a MemoryResourceGuard is active (GameInstance sets its arena)
+std::pmr::memory_resource* memoryResource();
+
+class MemoryResourceGuard
+{
+    public:
+        MemoryResourceGuard(std::pmr::memory_resource* resource);
+        MemoryResourceGuard(const MemoryResourceGuard&) = delete;
+        ~MemoryResourceGuard();
+    private:
+        std::pmr::memory_resource* prev;
+};
+
+// a game's memory pool, counted: the game holds one reference and every allocator using it one more (see
+// GameAllocator), so a handle or copy kept after the game is gone (getVariable(), a task's snapshot of a list) keeps the
+// pool alive instead of pointing into freed memory. the pool returns its memory in one go once the last reference is dropped
+class GameArena: public std::pmr::memory_resource
+{
+    public:
+        static std::shared_ptr<std::pmr::memory_resource> create();
+        // nullptr if resource isn't a GameArena
+        static GameArena* of(std::pmr::memory_resource* resource)
+        { return resource == std::pmr::new_delete_resource()? nullptr : dynamic_cast<GameArena*>(resource); }
+
+        void retain() noexcept { refs.fetch_add(1, std::memory_order_relaxed); }
+        void release() noexcept { if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1) { delete this; } }
+    private:
+        GameArena() = default;
+        void* do_allocate(size_t bytes, size_t alignment) override { return pool.allocate(bytes, alignment); }
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override { pool.deallocate(ptr, bytes, alignment); }
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        std::pmr::unsynchronized_pool_resource pool;
+        std::atomic<size_t> refs{1};
+};
+
+// polymorphic_allocator that defaults to memoryResource() instead of the process wide default resource.
+// copies of a container go to the resource active at the time of the copy.
+// while any copy of it exists (a container, a shared_ptr control block) it holds a reference to its resource if that's
+// a GameArena, so storage shared with a game's containers stays valid after the game is gone
+template <typename T>
+class GameAllocator: public std::pmr::polymorphic_allocator<T>
+{
+    public:
+        GameAllocator() noexcept: GameAllocator(memoryResource()) {}
+        GameAllocator(std::pmr::memory_resource* resource) noexcept:
+            std::pmr::polymorphic_allocator<T>(resource), arena(GameArena::of(resource)) { retain(); }
+        GameAllocator(const GameAllocator &other) noexcept:
+            std::pmr::polymorphic_allocator<T>(other.resource()), arena(other.arena) { retain(); }
+        template <typename U>
+        GameAllocator(const GameAllocator<U> &other) noexcept:
+            std::pmr::polymorphic_allocator<T>(other.resource()), arena(other.arena) { retain(); }
+        ~GameAllocator() { if(arena) { arena->release(); } }
+
+        GameAllocator select_on_container_copy_construction() const { return GameAllocator(); }
+    private:
+        template <typename U> friend class GameAllocator;
+        void retain() noexcept { if(arena) { arena->retain(); } }
+
+        GameArena* arena;
+};
+
 class Variable;
-using mapType = std::map<std::string, std::shared_ptr<std::string>>;
-using varMapType = std::map<std::string, std::shared_ptr<Variable>>;
+class VariableIndex;
+// keys are interned at insertion, so lookups compare ints. iteration follows insertion order,
+// use ordered() where output has to be stable
+// maps and lists are copy on write, so copying a varType (get(), task arguments) is O(1)
+template <typename T>
+using gameMap = CowMap<FlatMap<Symbol, T, GameAllocator<std::pair<Symbol, T>>>>;
+using mapType = gameMap<std::shared_ptr<std::string>>;
+using varMapType = gameMap<std::shared_ptr<Variable>>;
 // shared_ptr bc listObjs can be used to collect/group pre-existing variables to perform operations on
-using listObj = std::vector<std::shared_ptr<Variable>>;
+using listObj = CowList<std::shared_ptr<Variable>, GameAllocator<std::shared_ptr<Variable>>, VariableIndex>;
+// homogeneous lists store values contiguously instead of one Variable per element, so scans are linear.
+// elements are plain values: get_at returns a copy, and writing a value of another type converts to listObj
+using intList = CowList<int, GameAllocator<int>>;
+using stringList = CowList<std::string, GameAllocator<std::string>>;
+// cards as one byte codes into a shared CardTable. get_at/expand give each card as a varMapType {rank, suit, name}
+using deckObj = CardDeck<GameAllocator<uint8_t>>;
 using varType = std::variant<
                 int,
                 std::string,
@@ -29,6 +112,9 @@ using varType = std::variant<
                 mapType,
                 listObj,
                 varMapType,
+                intList,
+                stringList,
+                deckObj,
                 std::shared_ptr<void>, // technically support all types, should be avoided where possible
                 std::monostate>; // NULL
 using varTypeBorrowedPtr = varType*;
@@ -36,7 +122,7 @@ using varTypeBorrowedPtr = varType*;
 
 enum Type
 {
-    INT, STRING, BOOL, MAP, LIST, VAR_MAP, POINTER, NONE // ensure order matches order in variant
+    INT, STRING, BOOL, MAP, LIST, VAR_MAP, INT_LIST, STRING_LIST, DECK, POINTER, NONE // ensure order matches order in variant
 };
 class BadVariableArgException : public std::exception {
     public:
@@ -57,18 +143,32 @@ namespace VariableUtils
     void printValue(const varType &var, std::string_view delim="", std::ostream& stream=std::cout);
     Type getType(const varType &var);
     bool compare(const varType &var1, const varType &var2);
+    size_t hash(const varType &var); // compare(a, b) implies hash(a) == hash(b)
 
     std::string getWithKey(varType &var1, const varType &key); // only mapType
-    std::shared_ptr<Variable> getVarWithKey(varType &var1, const varType &key); // only varMapType and listObj
+    // only varMapType and lists. an intList/stringList becomes a listObj, so writes through the result stick
+    std::shared_ptr<Variable> getVarWithKey(varType &var1, const varType &key);
+    std::shared_ptr<Variable> getVarWithKey(const varType &var1, const Symbol &key); // only varMapType
+
+    // borrowing versions: no copies, allocations or ref count changes.
+    // results point into var1 so only use them while var1 is unchanged
+    std::string_view viewWithKey(const varType &var1, const varType &key); // only mapType, "" if missing
+    Variable* borrowVarWithKey(const varType &var1, const varType &key); // only varMapType and listObj, throws on other lists
+    Variable* borrowVarWithKey(const varType &var1, const Symbol &key); // only varMapType
 
     size_t size(const varType &var1);
 };
 
 
+// value is stored inline so a shared_ptr<Variable> (listObj element, scope entry) is a single
+// allocation with a single control block. aliasing is done through the shared_ptr<Variable> handle
+// versions are handed out from one counter, so a version is never reused, not even by another Variable
+uint64_t nextVersion();
+
 class Variable // in class to make future implementation changes easier
 {
     public:
-        Variable(varType val):value(std::make_shared<varType>(val)) {}
+        Variable(varType val):value(std::move(val)) {}
         Variable();//temporary
         bool operator==(const Variable &var) const;
         bool isEqual(const varType &other) const;
@@ -78,23 +178,48 @@ class Variable // in class to make future implementation changes easier
         void set(const varType &val, const varType &val2); // mapType and listObj only
         void set(const varType &val, Variable &val2); // varMapType and listObj only
 
-        varType get() const { return *value; }
-        varType& getRef() const { return *value; }
-        std::shared_ptr<varType> getPtr() const { return value; }
-        varTypeBorrowedPtr getBorrowPtr() const { return value.get(); }
+        varType get() const { return value; }
+        varType& getRef() const { return value; }
+        varTypeBorrowedPtr getBorrowPtr() const { return &value; }
         std::string get(const varType &key); // mapType only
 
         size_t size() const;
 
+        // changes whenever the value does: set(), the ListObjUtils functions taking a Variable, or touch() after
+        // changing it through getRef(). EnvironmentManager's memo cache relies on it
+        uint64_t version() const { return stamp; }
+        void touch() { stamp = nextVersion(); }
+
         void print();
         Type type();
     protected:
-        std::shared_ptr<varType> value;
+        mutable varType value; // mutable so getRef()/getBorrowPtr() keep their const signatures
+        uint64_t stamp = nextVersion();
 
 };
 
+// membership index of a listObj (see CowList::getIndex): its elements by VariableUtils::hash. the elements are shared
+// Variables that can change without the list being touched, so it keeps each one's version and is rebuilt once any
+// of them has moved on. checking that is one pass over the versions, no values are compared
+class VariableIndex
+{
+    public:
+        explicit VariableIndex(const listObj &list);
+        bool current(const listObj &list) const;
+        bool contains(const varType &item) const; // items of another type never match, like ListObjUtils::contains
+    private:
+        std::vector<std::pair<const Variable*, uint64_t>> versions; // in list order
+        std::unordered_multimap<size_t, const Variable*> items;
+};
+
 
 std::shared_ptr<Variable> makeVarPtr(varType val);
+// make_shared<Variable> from the given resource (memoryResource() by default). a Variable from a GameArena keeps it alive
+template<class... Args>
+std::shared_ptr<Variable> allocateVar(GameAllocator<Variable> alloc, Args && ... args)
+{ return std::allocate_shared<Variable>(alloc, std::forward<Args>(args)...); }
+// shared_ptr to the value of var that keeps var alive
+std::shared_ptr<varType> valuePtr(const std::shared_ptr<Variable> &var);
 template<class... Args>
 std::shared_ptr<Variable> makeVarPtr(Args && ... args);
 Variable makeVar(varType val);
@@ -105,19 +230,48 @@ Variable makeVar(varType val);
 namespace ListObjUtils
 {
     void push_back(varType &var, const varType &val);
-    void remove(varType &var, const varType &val);
+    void remove(varType &var, const varType &val); // drops the first val items (all if there are fewer). O(val)
+    // moves the first count items of from to the end of to (all if there are fewer). O(count), the rest of from
+    // isn't shifted and listObj elements keep their Variables
+    void deal(varType &from, varType &to, const varType &count);
 
     void insert_at(varType &var, const varType &val, const varType &indx);
     void insert_at(varType &var, const Variable &val, const varType &indx);
 
     void remove_at(varType &var, const varType &val);
     std::shared_ptr<Variable> get_at(varType &var1, const varType &key);
-    bool contains(varType &var1, const varType &key);
+    bool contains(const varType &var1, const varType &key);
+    bool contains(const listObj &list, const varType &key); // lists of indexThreshold items up use the list's index
     listObj::iterator begin(varType &var1);
     listObj::iterator end(varType &var1);
 
-    void shuffle(varType &var);
+    void shuffle(varType &var, Random &rng); // use the game's generator so sessions can be replayed
+    void shuffle(varType &var); // thread local generator, seeded once
     void reverse(varType &var);
+    // stable sort. for a listObj of maps keyPath picks the value to sort by ({"stats", "wins"} is item.stats.wins).
+    // keys are read once per element, ordered bool < int < string, missing/unsortable keys go last.
+    // big lists are sorted on several threads
+    void sort(varType &var, const std::vector<Symbol> &keyPath = {});
+
+    // typed lists
+    // same as above, and touch() var so its version changes
+    void push_back(Variable &var, const varType &val);
+    void remove(Variable &var, const varType &val);
+    void deal(Variable &from, Variable &to, const varType &count);
+    void insert_at(Variable &var, const varType &val, const varType &indx);
+    void remove_at(Variable &var, const varType &val);
+    void shuffle(Variable &var, Random &rng);
+    void reverse(Variable &var);
+    void sort(Variable &var, const std::vector<Symbol> &keyPath = {});
+
+    bool isList(const varType &var); // listObj, intList, stringList or deckObj
+    // listObj of only ints/only strings -> intList/stringList. skipped if any element (or the list storage) is
+    // shared, since the elements stop being Variables
+    void compact(varType &var);
+    void expand(varType &var); // intList/stringList/deckObj -> listObj
+    int sum(const varType &var); // ints only
+    varType min(const varType &var); // all ints or all strings
+    varType max(const varType &var);
 };
 
 
@@ -132,6 +286,7 @@ static Variable makeVar(Args && ... args)
     }
 
     varType list = listObj();
+    std::get<listObj>(list).reserve(sizeof...(args));
     for(const auto &item: {args...})
     {
         ListObjUtils::push_back(list, item);
@@ -144,19 +299,20 @@ std::shared_ptr<Variable> makeVarPtr(Args && ... args)
 {
     //temporary
     if(sizeof...(args)==0)
-        return std::make_shared<Variable>();
+        return allocateVar({});
     if(sizeof...(args) == 1)
     {
         auto& first = [](auto& first, auto&...) -> auto& { return first; }(args...);
-        return std::make_shared<Variable>(first);
+        return allocateVar({}, first);
     }
     varType list = listObj();
+    std::get<listObj>(list).reserve(sizeof...(args));
     for(const auto &item: {args...})
     {
         varType temp(item);
         ListObjUtils::push_back(list, temp);
     }
-    return std::make_shared<Variable>(list);
+    return allocateVar({}, std::move(list));
 }
 };
 
@@ -1,9 +1,14 @@
 #include "EnvironmentMgr.hpp"
+#include "Expression.hpp"
+#include "StringTemplate.hpp"
+#include "RuleProgram.hpp"
 #include <gtest/gtest.h>
 #include <memory>
 #include <filesystem>
 #include <fstream>
 #include <gmock/gmock.h>
+#include <cstdlib>
+#include <new>
 
 
 using namespace var;
@@ -14,6 +19,45 @@ extern "C" {
   TSLanguage* tree_sitter_socialgaming();
 }
 
+// counts the heap allocations made on this thread from its construction until stop() (or its destruction).
+// operator new below is replaced for the whole test binary, but only counts while a counter is running
+namespace
+{
+    class AllocationCounter
+    {
+        public:
+            AllocationCounter(): previous(running) { running = this; }
+            AllocationCounter(const AllocationCounter&) = delete;
+            ~AllocationCounter() { stop(); }
+
+            size_t stop()
+            {
+                if(running == this) { running = previous; }
+                return allocations;
+            }
+            static void allocated() { if(running) { running->allocations++; } }
+        private:
+            static thread_local AllocationCounter* running;
+            AllocationCounter* previous;
+            size_t allocations = 0;
+    };
+    thread_local AllocationCounter* AllocationCounter::running = nullptr;
+}
+void* operator new(size_t size)
+{
+    AllocationCounter::allocated();
+    if(void* ptr = std::malloc(size ? size : 1)) { return ptr; }
+    throw std::bad_alloc();
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    AllocationCounter::allocated();
+    return std::malloc(size ? size : 1);
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
 class EnvMgrFixture: public testing::Test
 {
     protected:
@@ -201,3 +245,525 @@ TEST_F(EnvMgrFixture, forloopTest)
 
     // continue after for loop...
 }
+
+// player.name through the borrowing accessors shouldn't touch the heap
+TEST(EnvMgrTest, borrowLookupTest)
+{
+    // init
+    EnvironmentManager mgr;
+    varMapType player;
+    player[Symbol("name")] = makeVarPtr("player1");
+    mgr.setVariable("player", makeVarPtr(listObj{makeVarPtr(player)}));
+    varType index = 0;
+
+    AllocationCounter counter;
+    Variable* players = mgr.borrowVariable("player");
+    Variable* first = VariableUtils::borrowVarWithKey(players->getRef(), index);
+    Variable* name = VariableUtils::borrowVarWithKey(first->getRef(), Symbol::find("name").value());
+    std::string_view view = std::get<std::string>(name->getRef());
+    size_t allocations = counter.stop();
+
+    // asserts
+    ASSERT_EQ(0, allocations);
+    ASSERT_EQ("player1", view);
+    ASSERT_EQ(nullptr, mgr.borrowVariable("never used name"));
+    // looking a name up by string never interns it
+    ASSERT_EQ(nullptr, mgr.getVariable("never used name"));
+    ASSERT_EQ(nullptr, mgr.hasVar(std::string("never used name")));
+    ASSERT_FALSE(Symbol::find("never used name").has_value());
+}
+
+// loops walk a snapshot of the list with a cursor + leave the list alone
+TEST(EnvMgrTest, loopCursorTest)
+{
+    // init
+    EnvironmentManager mgr;
+    mgr.setVariable("rounds", makeVarPtr("round1", "round2", "round3"));
+    auto loop = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto body = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE);
+    loop->setChildren({"true"}, body);
+
+    // asserts
+    std::vector<std::string> expected = {"round1", "round2", "round3"};
+    bool shouldBlock;
+    auto next = mgr.enterScope(loop);
+    for(const auto &round: expected)
+    {
+        ASSERT_EQ(body, next);
+        ASSERT_TRUE(mgr.getVariable("round")->isEqual(round));
+        ListObjUtils::push_back(mgr.getVariable("rounds")->getRef(), "added during loop"); // not iterated
+
+        next = mgr.exitScope(shouldBlock);
+        if(&round != &expected.back())
+        {
+            ASSERT_EQ(loop, next);
+            next = mgr.enterScope(next);
+        }
+    }
+
+    ASSERT_EQ(loop->getNextNode(), next);
+    ASSERT_EQ(nullptr, mgr.getVariable("round"));
+    ASSERT_EQ(6, mgr.getVariable("rounds")->size());
+    ASSERT_TRUE(ListObjUtils::get_at(mgr.getVariable("rounds")->getRef(), 0)->isEqual("round1"));
+}
+
+// a snapshot taken mid loop restores into another manager and carries on from the same element
+TEST(EnvMgrTest, snapshotTest)
+{
+    // init
+    EnvironmentManager mgr;
+    mgr.setVariable("rounds", makeVarPtr("round1", "round2", "round3"));
+    auto loop = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto body = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE);
+    auto after = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::SCORES);
+    loop->setChildren({"true"}, body);
+    loop->setNextNode(after);
+
+    bool shouldBlock;
+    mgr.enterScope(loop);
+    mgr.exitScope(shouldBlock);
+    mgr.enterScope(loop); // on round2
+    mgr.enterScope(body, Timer(1, after, 60, Timer::Type::STOP, "timedOut"));
+    std::string data = mgr.snapshot(loop);
+
+    EnvironmentManager restored;
+    restored.restore(data, loop);
+
+    // asserts
+    ASSERT_EQ(mgr.depth(), restored.depth());
+    ASSERT_TRUE(restored.getVariable("round")->isEqual("round2"));
+    ASSERT_TRUE(restored.getVariable("timedOut")->isEqual(false));
+    ASSERT_NE(nullptr, restored.getTimer(1));
+    ASSERT_EQ(after, restored.getTimer(1)->nextRuleNode);
+    ASSERT_FALSE(restored.getTimer(1)->isExpired());
+    ASSERT_EQ(data, restored.snapshot(loop));
+
+    restored.exitScope(shouldBlock); // timer scope
+    ASSERT_EQ(loop, restored.exitScope(shouldBlock));
+    ASSERT_EQ(body, restored.enterScope(loop));
+    ASSERT_TRUE(restored.getVariable("round")->isEqual("round3"));
+    ASSERT_EQ(after, restored.exitScope(shouldBlock));
+
+    ASSERT_THROW(restored.restore(data, after), BadVariableArgException); // different rules
+}
+
+// only names are interned when a rule is parsed, literals and operators stay strings
+TEST(EnvMgrTest, internTest)
+{
+    // init
+    auto node = std::make_shared<TaskRuleNode>(
+        std::vector<std::vector<std::string>>{{"winner.score", "+", "\"never interned\"", "1234567"}}, NodeType::ASSIGNMENT);
+    const auto &symbols = node->getSymbols();
+
+    // asserts
+    ASSERT_EQ(1, symbols.size());
+    ASSERT_EQ(4, symbols[0].size());
+    ASSERT_EQ(Symbol("winner.score"), symbols[0][0]);
+    ASSERT_TRUE(symbols[0][1].empty());
+    ASSERT_TRUE(symbols[0][2].empty());
+    ASSERT_TRUE(symbols[0][3].empty());
+    ASSERT_FALSE(Symbol::find("\"never interned\"").has_value());
+    ASSERT_FALSE(Symbol::find("1234567").has_value());
+}
+
+// resolved names go straight to their scope's slot, unresolved ones still work by name
+TEST(EnvMgrTest, slotTest)
+{
+    // init
+    EnvironmentManager mgr;
+    mgr.setVariable("rounds", makeVarPtr("round1", "round2"));
+    mgr.setVariable("players", makeVarPtr("player1", "player2"));
+    auto outer = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto inner = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"player"}, {"in", "players"}}, NodeType::FOR);
+    auto body = std::make_shared<TaskRuleNode>(
+        std::vector<std::vector<std::string>>{{"round", "player", "score"}}, NodeType::MESSAGE);
+    outer->setChildren({"true"}, inner);
+    inner->setChildren({"true"}, body);
+    mgr.resolve(outer, {Symbol("rounds")});
+
+    // asserts
+    ASSERT_EQ((SlotRef{0, 0}), outer->getSlots().at(2).at(1)); // rounds
+    ASSERT_EQ((SlotRef{1, 0}), outer->getSlots().at(1).at(0)); // round
+    ASSERT_FALSE(inner->getSlots().at(2).at(1).resolved()); // players isn't a global
+    std::vector<SlotRef> slots = body->getSlots().at(0);
+    ASSERT_EQ((SlotRef{1, 0}), slots.at(0));
+    ASSERT_EQ((SlotRef{2, 0}), slots.at(1));
+    ASSERT_FALSE(slots.at(2).resolved());
+
+    ASSERT_EQ(inner, mgr.enterScope(outer));
+    ASSERT_EQ(body, mgr.enterScope(inner));
+    ASSERT_TRUE(mgr.getVariable(Symbol("round"), slots.at(0))->isEqual("round1"));
+    ASSERT_TRUE(mgr.getVariable(Symbol("player"), slots.at(1))->isEqual("player1"));
+    ASSERT_TRUE(mgr.getVariable("player")->isEqual("player1"));
+
+    mgr.setVariable(Symbol("score"), slots.at(2), 3); // unresolved -> by name
+    ASSERT_TRUE(mgr.getVariable("score")->isEqual(3));
+    mgr.setVariable(Symbol("round"), slots.at(0), "changed");
+    ASSERT_TRUE(mgr.getVariable("round")->isEqual("changed"));
+
+    // slot lookups don't allocate
+    AllocationCounter counter;
+    Variable* player = mgr.borrowVariable(Symbol("player"), slots.at(1));
+    ASSERT_EQ(0, counter.stop());
+    ASSERT_TRUE(player->isEqual("player1"));
+
+    // a scope the resolver didn't know about shifts the depths: falls back to the name
+    mgr.enterScope(body, Timer(1, nullptr, 60));
+    ASSERT_TRUE(mgr.getVariable(Symbol("player"), SlotRef{3, 0})->isEqual("player1"));
+
+    // the global scope keeps values set before resolving in their slot
+    std::string data = mgr.snapshot(outer);
+    EnvironmentManager restored;
+    restored.resolve(outer, {Symbol("rounds")});
+    restored.restore(data, outer);
+    ASSERT_EQ(2, restored.getVariable(Symbol("rounds"), SlotRef{0, 0})->size());
+    ASSERT_TRUE(restored.getVariable(Symbol("player"), slots.at(1))->isEqual("player1"));
+    ASSERT_EQ(data, restored.snapshot(outer));
+}
+
+// scope frames are recycled: once warmed up, nested loops don't allocate
+TEST(EnvMgrTest, scopeReuseTest)
+{
+    // init
+    EnvironmentManager mgr(std::make_shared<std::pmr::unsynchronized_pool_resource>());
+    mgr.setVariable("rounds", makeVarPtr("round1", "round2", "round3"));
+    mgr.setVariable("players", makeVarPtr("player1", "player2"));
+    auto outer = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto inner = std::make_shared<ControlFlowRuleNode>(
+        std::vector<std::vector<std::string>>{{"for"}, {"player"}, {"in", "players"}}, NodeType::PARALLEL);
+    auto body = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE);
+    outer->setChildren({"true"}, inner);
+    inner->setChildren({"true"}, body);
+    mgr.resolve(outer, {Symbol("rounds"), Symbol("players")});
+
+    // runs the game, nullptr is the end of the outer loop's body
+    auto play = [&]()
+    {
+        int bodies = 0;
+        bool shouldBlock;
+        auto next = mgr.enterScope(outer);
+        while(next || mgr.depth() > 1)
+        {
+            if(next == body) { bodies++; }
+            next = (next == body || next == nullptr)? mgr.exitScope(shouldBlock) : mgr.enterScope(next);
+        }
+        return bodies;
+    };
+
+    // asserts
+    ASSERT_EQ(6, play());
+    ASSERT_EQ(1, mgr.depth());
+
+    AllocationCounter counter;
+    int bodies = play();
+    size_t allocations = counter.stop();
+    ASSERT_EQ(6, bodies);
+    ASSERT_EQ(0, allocations);
+
+    mgr.reset();
+    ASSERT_EQ(1, mgr.depth());
+    ASSERT_EQ(nullptr, mgr.getVariable("rounds"));
+}
+
+// timers fire on their tick (not before) from every level of the wheel, cancelled ones never do
+TEST(TimerWheelTest, fireTest)
+{
+    // init
+    using namespace std::chrono_literals;
+    auto start = TimerWheel::clock::now();
+    TimerWheel wheel(start);
+    wheel.schedule(1, 10, 5ms, start);
+    wheel.schedule(2, 20, 300ms, start); // level 1
+    auto cancelled = wheel.schedule(1, 11, 300ms, start);
+    wheel.schedule(3, 30, 20s, start); // level 2
+    wheel.schedule(1, 12, 2h, start); // level 3
+    wheel.schedule(2, 21, 30h, start); // past the last level
+    wheel.schedule(3, 31, 0ms, start);
+
+    // asserts
+    ASSERT_EQ(7, wheel.size());
+    ASSERT_TRUE(wheel.cancel(cancelled));
+    ASSERT_FALSE(wheel.cancel(cancelled));
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{3, 31}}), wheel.advance(start + 4ms));
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{1, 10}}), wheel.advance(start + 5ms));
+    ASSERT_TRUE(wheel.advance(start + 299ms).empty());
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{2, 20}}), wheel.advance(start + 300ms));
+    ASSERT_TRUE(wheel.advance(start + 20s - 1ms).empty());
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{3, 30}}), wheel.advance(start + 20s));
+    ASSERT_TRUE(wheel.advance(start + 2h - 1ms).empty());
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{1, 12}}), wheel.advance(start + 2h));
+    ASSERT_TRUE(wheel.advance(start + 30h - 1ms).empty());
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{2, 21}}), wheel.advance(start + 30h));
+    ASSERT_EQ(0, wheel.size());
+}
+
+// a manager on a wheel only learns about the timers that fired, and takes its timers out when it drops them
+TEST(EnvMgrTest, timerWheelTest)
+{
+    // init
+    using namespace std::chrono_literals;
+    auto wheel = std::make_shared<TimerWheel>();
+    EnvironmentManager mgr;
+    mgr.setTimerWheel(wheel, 7);
+    auto body = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE);
+    auto after = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::SCORES);
+
+    // asserts
+    mgr.enterScope(body, Timer(1, after, 50ms, Timer::Type::STOP, "timedOut"));
+    mgr.enterScope(body, Timer(2, nullptr, 1h));
+    ASSERT_EQ(3, mgr.depth());
+    ASSERT_EQ(2, wheel->size());
+    ASSERT_TRUE(mgr.getVariable("timedOut")->isEqual(false));
+
+    auto fired = wheel->advance(TimerWheel::clock::now() + 100ms);
+    ASSERT_EQ((std::vector<TimerWheel::Fired>{{7, 1}}), fired);
+    ASSERT_EQ(after, mgr.fireTimers({fired.front().timer}));
+    ASSERT_TRUE(mgr.getVariable("timedOut")->isEqual(true));
+    ASSERT_EQ(1, mgr.depth()); // stop timer exited its scope and the one inside it
+    ASSERT_EQ(0, wheel->size()); // inner timer went with its scope
+    ASSERT_EQ(nullptr, mgr.fireTimers({1, 2})); // already gone
+
+    mgr.enterScope(body, Timer(3, nullptr, 1h));
+    ASSERT_EQ(1, wheel->size());
+    mgr.reset();
+    ASSERT_EQ(0, wheel->size());
+}
+
+// expressions are compiled once, then evaluated against whatever is in scope
+TEST(ExpressionTest, evaluateTest)
+{
+    // init
+    EnvironmentManager mgr;
+    mgr.setVariable("winners", makeVarPtr(listObj()));
+    varMapType player1, player2;
+    player1[Symbol("name")] = makeVarPtr("player1");
+    player1[Symbol("score")] = makeVarPtr(3);
+    player2[Symbol("name")] = makeVarPtr("player2");
+    player2[Symbol("score")] = makeVarPtr(0);
+    mgr.setVariable("players", makeVarPtr(listObj{makeVarPtr(player1), makeVarPtr(player2)}));
+    auto eval = [&mgr](std::vector<std::string> tokens) { return Expression::compile(tokens).evaluate(mgr); };
+
+    // asserts
+    ASSERT_EQ(varType(true), eval({"=", "winners", "size", "0"}));
+    ASSERT_EQ(varType(false), eval({"!", "=", "players", "size", "2"}));
+    ASSERT_EQ(varType(5), eval({"+", "2", "3"}));
+    ASSERT_EQ(varType(std::string("unknown")), eval({"unknown"})); // not a variable: the token itself
+    ASSERT_EQ(varType(true), eval({"players.name", "contains", "player2"}));
+    ASSERT_EQ(varType(false), eval({"players.name", "contains", "nobody"}));
+    ASSERT_EQ(Type::STRING_LIST, VariableUtils::getType(eval({"players.name"}))); // scalar projections are typed
+    ASSERT_TRUE(VariableUtils::compare(intList{3, 0}, eval({"players.score"})));
+    ASSERT_EQ(varType(true), eval({"players.score", "contains", "0"}));
+    ASSERT_TRUE(VariableUtils::compare(makeVar(1, 2, 3).getRef(), eval({"3", "upfrom", "1"})));
+    mgr.setVariable("mixed", makeVarPtr(listObj{makeVarPtr(player1), makeVarPtr(4)}));
+    ASSERT_THROW(eval({"mixed.name"}), BadVariableArgException); // an element that isn't a map has no keys
+
+    // the right side isn't evaluated (it would throw, not a bool) when the left decides
+    ASSERT_EQ(varType(true), eval({"|", "true", "2"}));
+    ASSERT_EQ(varType(false), eval({"&", "false", "2"}));
+    ASSERT_THROW(eval({"|", "false", "2"}), BadVariableArgException);
+
+    varType scored = eval({"players", "collect", "player", "!", "=", "player.score", "0"});
+    ASSERT_EQ(1, VariableUtils::size(scored));
+    ASSERT_EQ("player1", std::get<std::string>(VariableUtils::borrowVarWithKey(
+        std::get<listObj>(scored)[0]->getRef(), Symbol("name"))->getRef()));
+
+    ASSERT_THROW(Expression::compile({"=", "winners"}), BadVariableArgException);
+    ASSERT_THROW(Expression::compile({"winners", "size", "extra"}), BadVariableArgException);
+
+    // resolve() compiles every row, evaluating a compiled guard doesn't allocate
+    auto rule = std::make_shared<TaskRuleNode>(
+        std::vector<std::vector<std::string>>{{"=", "winners", "size", "0"}, {"=", "winners"}}, NodeType::MESSAGE);
+    mgr.resolve(rule, {Symbol("winners")});
+    ASSERT_EQ(nullptr, rule->getExpressions().at(1));
+    const Expression &guard = *rule->getExpressions().at(0);
+    guard.evaluate(mgr);
+    AllocationCounter counter;
+    varType result = guard.evaluate(mgr);
+    ASSERT_EQ(0, counter.stop());
+    ASSERT_EQ(varType(true), result);
+}
+
+// placeholders are split out once, rendering only appends
+TEST(StringTemplateTest, renderTest)
+{
+    // init
+    EnvironmentManager mgr;
+    mgr.setVariable("round", 2);
+    varMapType player1, player2;
+    player1[Symbol("name")] = makeVarPtr("player1");
+    player2[Symbol("name")] = makeVarPtr("player2");
+    mgr.setVariable("player", makeVarPtr(player1));
+    mgr.setVariable("winners", makeVarPtr(listObj{makeVarPtr(player1), makeVarPtr(player2)}));
+    std::string out;
+
+    // asserts
+    StringTemplate::compile("Round {round}. Choose your weapon!").render(mgr, out);
+    ASSERT_EQ("Round 2. Choose your weapon!", out);
+    ASSERT_EQ("player1, choose your weapon!", StringTemplate::compile("{player.name}, choose your weapon!").render(mgr));
+    ASSERT_EQ("Winners: player1, player2", StringTemplate::compile("Winners: {winners.elements.name}").render(mgr));
+    ASSERT_EQ("2 and 2, player1", StringTemplate::compile("{round} and { round }, {player.name}").render(mgr));
+    ASSERT_EQ("{missing} {} {", StringTemplate::compile("{missing} {} {").render(mgr));
+
+    // quoted tokens in rules render too, and keep their quotes like other strings
+    auto round = Expression::compile({"\"Round {round}\""});
+    ASSERT_EQ(varType(std::string("\"Round 2\"")), round.evaluate(mgr));
+    // compiled once, later evaluations just render with the current values
+    mgr.setVariable("round", 3);
+    AllocationCounter parsing;
+    varType again = round.evaluate(mgr);
+    ASSERT_GE(1, parsing.stop()); // the rendered string
+    ASSERT_EQ(varType(std::string("\"Round 3\"")), again);
+    mgr.setVariable("round", 2);
+
+    // rendering into a buffer that's big enough doesn't allocate
+    auto text = StringTemplate::compile("{player.name}, it's round {round}");
+    text.render(mgr, out);
+    AllocationCounter rendering;
+    text.render(mgr, out);
+    ASSERT_EQ(0, rendering.stop());
+    ASSERT_EQ("player1, it's round 2", out);
+}
+
+// cached results are reused until something they were computed from changes
+TEST(EnvMgrTest, evaluateCachedTest)
+{
+    // init
+    EnvironmentManager mgr;
+    varMapType player1, player2;
+    player1[Symbol("name")] = makeVarPtr("player1");
+    player2[Symbol("name")] = makeVarPtr("player2");
+    auto name2 = player2[Symbol("name")];
+    mgr.setVariable("players", makeVarPtr(listObj{makeVarPtr(player1), makeVarPtr(player2)}));
+    mgr.setVariable("round", 1);
+    auto names = Expression::compile({"players.name"});
+    auto count = Expression::compile({"players", "size"});
+    auto next = Expression::compile({"+", "round", "1"});
+
+    // asserts
+    const varType &first = mgr.evaluateCached(names);
+    ASSERT_EQ(2, VariableUtils::size(first));
+    AllocationCounter counter;
+    const varType &again = mgr.evaluateCached(names);
+    ASSERT_EQ(0, counter.stop());
+    ASSERT_EQ(&first, &again);
+
+    name2->set("renamed"); // an element's field
+    ASSERT_EQ("renamed", std::get<stringList>(mgr.evaluateCached(names))[1]);
+
+    ASSERT_EQ(varType(2), mgr.evaluateCached(count));
+    ListObjUtils::push_back(*mgr.getVariable("players"), varType(player1)); // the list itself
+    ASSERT_EQ(varType(3), mgr.evaluateCached(count));
+
+    ASSERT_EQ(varType(2), mgr.evaluateCached(next));
+    mgr.setVariable("round", 5); // the name finds another Variable
+    ASSERT_EQ(varType(6), mgr.evaluateCached(next));
+    mgr.getVariable("round")->set(9);
+    ASSERT_EQ(varType(10), mgr.evaluateCached(next));
+
+    // names that weren't set count too
+    auto unset = Expression::compile({"later"});
+    ASSERT_EQ(varType(std::string("later")), mgr.evaluateCached(unset));
+    mgr.setVariable("later", 1);
+    ASSERT_EQ(varType(1), mgr.evaluateCached(unset));
+}
+
+// lowered rules run the same loops and matches by stepping a program counter
+TEST(RuleProgramTest, executeTest)
+{
+    // init
+    using rows = std::vector<std::vector<std::string>>;
+    EnvironmentManager mgr;
+    mgr.setVariable("rounds", makeVarPtr(1, 2, 3));
+    auto loop = std::make_shared<ControlFlowRuleNode>(rows{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto message = std::make_shared<TaskRuleNode>(rows{{"round"}}, NodeType::MESSAGE);
+    auto match = std::make_shared<ControlFlowRuleNode>(rows{{"round"}}, NodeType::MATCH);
+    auto first = std::make_shared<TaskRuleNode>(rows(), NodeType::SHUFFLE);
+    auto second = std::make_shared<TaskRuleNode>(rows(), NodeType::SORT);
+    auto after = std::make_shared<TaskRuleNode>(rows(), NodeType::SCORES);
+    loop->setChildren({"true"}, message);
+    message->setNextNode(match);
+    match->setChildren({"1"}, first);
+    match->setChildren({"2"}, second);
+    loop->setNextNode(after);
+    mgr.resolve(loop, {Symbol("rounds")});
+    auto program = RuleProgram::lower(loop);
+    RuleExecutor executor(program, mgr);
+
+    // asserts
+    using RuleOp = RuleProgram::Op;
+    std::vector<RuleOp> ops;
+    for(const auto &instruction : program->code()) { ops.push_back(instruction.op); }
+    ASSERT_EQ((std::vector<RuleOp>{RuleOp::LOOP, RuleOp::TASK, RuleOp::MATCH, RuleOp::TASK, RuleOp::JUMP,
+        RuleOp::TASK, RuleOp::JUMP, RuleOp::EXIT, RuleOp::NEXT, RuleOp::TASK}), ops);
+
+    std::vector<std::shared_ptr<RuleNode>> ran;
+    std::vector<int> rounds;
+    while(auto node = executor.next())
+    {
+        ran.push_back(node);
+        if(node == message) { rounds.push_back(std::get<int>(mgr.getVariable("round")->getRef())); }
+        if(node == first || node == second) { ASSERT_EQ(3, mgr.depth()); } // global, loop, match
+    }
+    ASSERT_EQ((std::vector<std::shared_ptr<RuleNode>>{message, first, message, second, message, after}), ran);
+    ASSERT_EQ((std::vector<int>{1, 2, 3}), rounds);
+    ASSERT_EQ(1, mgr.depth());
+    ASSERT_TRUE(executor.done());
+
+    ASSERT_TRUE(executor.jumpTo(after.get()));
+    ASSERT_EQ(after, executor.next());
+    ASSERT_FALSE(executor.jumpTo(nullptr));
+}
+
+// match arms are found by the target's value, guards that aren't literals still run in order
+TEST(RuleProgramTest, dispatchTest)
+{
+    // init
+    // a quoted guard is a string literal that keeps its quotes, so it only matches a value stored with them
+    using rows = std::vector<std::vector<std::string>>;
+    EnvironmentManager mgr;
+    mgr.setVariable("weapon", std::string("\"Rock\""));
+    mgr.setVariable("beats", std::string("\"Scissors\""));
+    auto match = std::make_shared<ControlFlowRuleNode>(rows{{"weapon"}}, NodeType::MATCH);
+    auto rock = std::make_shared<TaskRuleNode>(rows(), NodeType::SHUFFLE);
+    auto beats = std::make_shared<TaskRuleNode>(rows(), NodeType::SORT);
+    auto scissors = std::make_shared<TaskRuleNode>(rows(), NodeType::REVERSE);
+    auto again = std::make_shared<TaskRuleNode>(rows(), NodeType::DEAL);
+    auto one = std::make_shared<TaskRuleNode>(rows(), NodeType::DISCARD);
+    match->setChildren({"\"Rock\""}, rock);
+    match->setChildren({"beats"}, beats);
+    match->setChildren({"\"Scissors\""}, scissors);
+    match->setChildren({"\"Rock\""}, again);
+    match->setChildren({"1"}, one);
+    mgr.resolve(match, {Symbol("weapon"), Symbol("beats")});
+    auto program = RuleProgram::lower(match);
+    // the guards resolve() compiled (with slots) are the ones lowering used
+    ASSERT_EQ(5, match->getGuards().size());
+    ASSERT_LT(1, match->getGuards()[1].use_count());
+    ASSERT_LT(1, match->getExpressions()[0].use_count());
+    ASSERT_EQ(varType(std::string("\"Scissors\"")), match->getGuards()[1]->evaluate(mgr));
+    auto run = [&]()
+    {
+        RuleExecutor executor(program, mgr);
+        auto node = executor.next();
+        while(mgr.depth() > 1) { executor.next(); }
+        return node;
+    };
+
+    // asserts
+    ASSERT_EQ(rock, run());
+    mgr.setVariable("weapon", std::string("\"Scissors\""));
+    ASSERT_EQ(beats, run()); // a guard that isn't a literal, before the literal one
+    mgr.setVariable("beats", std::string("\"Paper\""));
+    ASSERT_EQ(scissors, run());
+    mgr.setVariable("weapon", 1);
+    ASSERT_EQ(one, run());
+    mgr.setVariable("weapon", std::string("1")); // literals only match values of their type
+    ASSERT_EQ(nullptr, run());
+    ASSERT_EQ(rock, match->getChildWithKey({"\"Rock\""}).child);
+    ASSERT_EQ(nullptr, match->getChildWithKey({"missing"}).child);
+}
@@ -1,4 +1,5 @@
 #include "Variables.hpp"
+#include "Serializer.hpp"
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
@@ -44,7 +45,7 @@ TEST(VariablesTest, mapTest)
 {
     // init
     mapType m;
-    m["hello"] = std::make_shared<std::string>("world");
+    m[Symbol("hello")] = std::make_shared<std::string>("world");
     // init
     std::shared_ptr<Variable> v = makeVarPtr(m);
 
@@ -112,7 +113,7 @@ TEST(VariablesTest, varMapTest)
 {
     // init
     varMapType m;
-    m["hello"] = makeVarPtr("world");
+    m[Symbol("hello")] = makeVarPtr("world");
     // init
     std::shared_ptr<Variable> v = makeVarPtr(m);
 
@@ -132,6 +133,483 @@ TEST(VariablesTest, varMapTest)
     varType index{"hello world"};
     ASSERT_EQ(*(VariableUtils::getVarWithKey(v->getRef(), index)), var);
 }
+// check value is stored inline + handles still alias
+TEST(VariablesTest, inlineValueTest)
+{
+    // init
+    std::shared_ptr<Variable> list = makeVarPtr(1, 2, 3);
+    varTypeBorrowedPtr borrowed = list->getBorrowPtr();
+
+    // asserts
+    ListObjUtils::push_back(list->getRef(), 4);
+    ASSERT_EQ(borrowed, list->getBorrowPtr());
+    ASSERT_EQ(4, VariableUtils::size(*borrowed));
+
+    std::shared_ptr<Variable> item = ListObjUtils::get_at(list->getRef(), 0);
+    item->set(10);
+    ASSERT_TRUE(ListObjUtils::get_at(list->getRef(), 0)->isEqual(10));
+
+    std::shared_ptr<varType> value = valuePtr(list);
+    ASSERT_EQ(borrowed, value.get());
+    ASSERT_EQ(2, list.use_count());
+}
+// check Variables + containers are allocated from the active memory resource
+TEST(VariablesTest, memoryResourceTest)
+{
+    // init
+    std::pmr::monotonic_buffer_resource arena;
+    std::shared_ptr<Variable> list;
+    {
+        MemoryResourceGuard guard(&arena);
+        ASSERT_EQ(&arena, memoryResource());
+        list = makeVarPtr(1, 2, 3);
+    }
+
+    // asserts
+    ASSERT_EQ(std::pmr::new_delete_resource(), memoryResource());
+
+    // pushed elements use the list's resource even without a guard
+    ListObjUtils::push_back(list->getRef(), 4);
+    ASSERT_EQ(&arena, std::get<listObj>(list->getRef()).get_allocator().resource());
+
+    // copies made outside the guard go to the heap
+    varType copy = list->get();
+    ASSERT_EQ(std::pmr::new_delete_resource(), std::get<listObj>(copy).get_allocator().resource());
+    ASSERT_TRUE(VariableUtils::compare(copy, list->getRef()));
+}
+// check map keys are interned
+TEST(VariablesTest, symbolTest)
+{
+    // init
+    Symbol name("name");
+    varMapType m;
+    m[Symbol("name")] = makeVarPtr("player1");
+    m[Symbol("wins")] = makeVarPtr(0);
+    std::shared_ptr<Variable> v = makeVarPtr(m);
+
+    // asserts
+    ASSERT_EQ(name, Symbol(std::string("name")));
+    ASSERT_NE(name, Symbol("wins"));
+    ASSERT_EQ("name", name.str());
+    ASSERT_FALSE(Symbol::find("never interned").has_value());
+
+    ASSERT_TRUE(VariableUtils::getVarWithKey(v->getRef(), name)->isEqual("player1"));
+    ASSERT_TRUE(VariableUtils::getVarWithKey(v->getRef(), varType{"wins"})->isEqual(0));
+    ASSERT_EQ(nullptr, VariableUtils::getVarWithKey(v->getRef(), varType{"missing key"}));
+}
+// check flat map lookups before + after the hash index is built
+TEST(VariablesTest, flatMapTest)
+{
+    // init
+    varMapType m;
+    varMapType reversed;
+    for(int i = 0; i < 20; i++)
+    {
+        m[Symbol("key" + std::to_string(i))] = makeVarPtr(i);
+        if(i == 4) { ASSERT_EQ(5, m.size()); } // still small
+    }
+    for(int i = 19; i >= 0; i--) { reversed[Symbol("key" + std::to_string(i))] = m[Symbol("key" + std::to_string(i))]; }
+
+    // asserts
+    for(int i = 0; i < 20; i++) { ASSERT_TRUE(m.at(Symbol("key" + std::to_string(i)))->isEqual(i)); }
+    ASSERT_EQ(m.end(), m.find(Symbol("key20")));
+    ASSERT_EQ(Symbol("key0"), m.begin()->first); // insertion order
+    ASSERT_EQ(m, reversed);
+
+    ASSERT_EQ(1, m.erase(Symbol("key3")));
+    ASSERT_EQ(0, m.erase(Symbol("key3")));
+    ASSERT_FALSE(m.contains(Symbol("key3")));
+    ASSERT_TRUE(m.at(Symbol("key19"))->isEqual(19));
+    ASSERT_NE(m, reversed);
+
+    auto sorted = ordered(m, [](const Symbol &a, const Symbol &b) { return a.str() < b.str(); });
+    ASSERT_EQ(19, sorted.size());
+    ASSERT_EQ("key0", sorted.front()->first.str());
+    ASSERT_EQ("key9", sorted.back()->first.str());
+
+    // moves take the entries and index instead of copying them
+    using flatMap = FlatMap<Symbol, int, std::allocator<std::pair<Symbol, int>>>;
+    static_assert(std::is_nothrow_move_constructible_v<flatMap> && std::is_nothrow_move_assignable_v<flatMap>);
+    flatMap big;
+    for(int i = 0; i < 20; i++) { big.insert({Symbol("key" + std::to_string(i)), i}); }
+    const auto *first = &*big.begin();
+    flatMap moved(std::move(big));
+    ASSERT_EQ(first, &*moved.begin());
+    flatMap assigned;
+    assigned = std::move(moved);
+    ASSERT_EQ(first, &*assigned.begin());
+    ASSERT_EQ(19, assigned.find(Symbol("key19"))->second);
+}
+// check homogeneous lists compact to typed lists + fall back to listObj
+TEST(VariablesTest, typedListTest)
+{
+    // init
+    varType ints = makeVar(3, 1, 2).get();
+    varType strings = makeVar("b", "c", "a").get();
+    varType check = makeVar(3, 1, 2).get();
+    ListObjUtils::compact(ints);
+    ListObjUtils::compact(strings);
+
+    // asserts
+    ASSERT_EQ(Type::INT_LIST, VariableUtils::getType(ints));
+    ASSERT_EQ(Type::STRING_LIST, VariableUtils::getType(strings));
+    ASSERT_TRUE(VariableUtils::compare(ints, check));
+    ASSERT_EQ(3, VariableUtils::size(ints));
+
+    ASSERT_TRUE(ListObjUtils::contains(ints, 2));
+    ASSERT_FALSE(ListObjUtils::contains(ints, 4));
+    ASSERT_FALSE(ListObjUtils::contains(ints, "2"));
+    ASSERT_TRUE(ListObjUtils::contains(strings, "a"));
+    ASSERT_EQ(6, ListObjUtils::sum(ints));
+    ASSERT_EQ(varType(1), ListObjUtils::min(ints));
+    ASSERT_EQ(varType(3), ListObjUtils::max(ints));
+    ASSERT_EQ(varType("a"), ListObjUtils::min(strings));
+    ASSERT_EQ(6, ListObjUtils::sum(check)); // listObj works too
+
+    ListObjUtils::push_back(ints, 4);
+    ListObjUtils::reverse(ints);
+    ASSERT_TRUE(ListObjUtils::get_at(ints, 0)->isEqual(4));
+    ASSERT_EQ(Type::INT_LIST, VariableUtils::getType(ints));
+
+    // indexing for a Variable can't hand out a detached copy: getVarWithKey makes it a listObj, borrowing throws
+    varType numbers = intList{1, 2, 3};
+    ASSERT_THROW(VariableUtils::borrowVarWithKey(numbers, 0), BadVariableArgException);
+    VariableUtils::getVarWithKey(numbers, 0)->set(10);
+    ASSERT_EQ(Type::LIST, VariableUtils::getType(numbers));
+    ASSERT_TRUE(VariableUtils::borrowVarWithKey(numbers, 0)->isEqual(10));
+
+    // a value of another type turns it back into a listObj
+    ListObjUtils::push_back(ints, "five");
+    ASSERT_EQ(Type::LIST, VariableUtils::getType(ints));
+    ASSERT_TRUE(ListObjUtils::contains(ints, "five"));
+
+    // elements referenced elsewhere stay Variables
+    std::shared_ptr<Variable> list = makeVarPtr(1, 2);
+    std::shared_ptr<Variable> item = ListObjUtils::get_at(list->getRef(), 0);
+    ListObjUtils::compact(list->getRef());
+    ASSERT_EQ(Type::LIST, list->type());
+}
+
+TEST(VariablesTest, indexTest)
+{
+    // init
+    varType ints = makeVar(3, 1, 2).get();
+    varType check = makeVar(3, 1, 2).get();
+    ListObjUtils::compact(ints);
+
+    mapType map1;
+    std::shared_ptr<std::string> john = std::make_shared<std::string>("John");
+    std::shared_ptr<std::string> zero = std::make_shared<std::string>("0");
+    map1[Symbol("name")] = john;
+    map1[Symbol("score")] = zero;
+    mapType map2;
+    map2[Symbol("score")] = zero;
+    map2[Symbol("name")] = john;
+
+    intList big;
+    for(int i=0; i<100; i++) { big.push_back(i); }
+
+    // asserts
+    ASSERT_EQ(VariableUtils::hash(1), VariableUtils::hash(1));
+    ASSERT_EQ(VariableUtils::hash("a"), VariableUtils::hash(std::string("a")));
+    ASSERT_TRUE(VariableUtils::compare(ints, check)); // equal lists of different kinds
+    ASSERT_EQ(VariableUtils::hash(ints), VariableUtils::hash(check));
+    ASSERT_NE(VariableUtils::hash(ints), VariableUtils::hash(makeVar(1, 2, 3).get()));
+    ASSERT_TRUE(VariableUtils::compare(map1, map2));
+    ASSERT_EQ(VariableUtils::hash(map1), VariableUtils::hash(map2)); // entry order doesn't matter
+
+    // big lists build an index on first lookup, dropped on the next change
+    ASSERT_TRUE(big.contains(99));
+    ASSERT_TRUE(big.isIndexed());
+    ASSERT_FALSE(big.contains(100));
+    big[0] = 100;
+    ASSERT_FALSE(big.isIndexed());
+    ASSERT_TRUE(big.contains(100));
+    ASSERT_FALSE(big.contains(0));
+    varType copy = big; // copies share the index with the storage
+    big.push_back(200);
+    ASSERT_TRUE(ListObjUtils::contains(big, 200));
+    ASSERT_FALSE(ListObjUtils::contains(copy, 200));
+
+    // a listObj's index also notices its elements changing, since they're shared Variables
+    listObj mixed;
+    for(int i=0; i<50; i++) { mixed.push_back(i % 2? makeVarPtr(i) : makeVarPtr(std::to_string(i))); }
+    ASSERT_TRUE(ListObjUtils::contains(mixed, 49));
+    ASSERT_TRUE(ListObjUtils::contains(mixed, "48"));
+    ASSERT_TRUE(mixed.isIndexed());
+    ASSERT_FALSE(ListObjUtils::contains(mixed, 48)); // other types never match
+    ASSERT_FALSE(ListObjUtils::contains(mixed, "100"));
+    const listObj &items = mixed; // reading doesn't drop the index
+    std::shared_ptr<Variable> element = items[1];
+    element->set(100);
+    ASSERT_TRUE(ListObjUtils::contains(mixed, 100));
+    ASSERT_FALSE(ListObjUtils::contains(mixed, 1));
+}
+
+TEST(VariablesTest, serializeTest)
+{
+    // init
+    mapType player;
+    player[Symbol("name")] = std::make_shared<std::string>("John");
+    player[Symbol("weapon")] = std::make_shared<std::string>("Rock");
+    std::shared_ptr<Variable> shared = makeVarPtr(player);
+    varMapType state;
+    state[Symbol("players")] = makeVarPtr(listObj{shared, shared, makeVarPtr(-7), makeVarPtr(true)});
+    state[Symbol("scores")] = makeVarPtr(intList{1, -2, 300000});
+    state[Symbol("names")] = makeVarPtr(stringList{"John", ""});
+    state[Symbol("none")] = makeVarPtr(std::monostate());
+    varType value = state;
+
+    std::string data = serialize(value);
+    varType copy = deserialize(data);
+    varMapType &result = std::get<varMapType>(copy);
+    varType &players = result[Symbol("players")]->getRef();
+
+    // asserts
+    ASSERT_EQ(Type::VAR_MAP, VariableUtils::getType(copy));
+    ASSERT_TRUE(VariableUtils::compare(result[Symbol("scores")]->getRef(), state[Symbol("scores")]->getRef()));
+    ASSERT_TRUE(VariableUtils::compare(result[Symbol("names")]->getRef(), state[Symbol("names")]->getRef()));
+    ASSERT_EQ(Type::NONE, result[Symbol("none")]->type());
+    ASSERT_EQ(4, VariableUtils::size(players));
+    ASSERT_TRUE(ListObjUtils::get_at(players, 2)->isEqual(-7));
+    ASSERT_TRUE(ListObjUtils::get_at(players, 3)->isEqual(true));
+    ASSERT_EQ("Rock", VariableUtils::getWithKey(ListObjUtils::get_at(players, 0)->getRef(), "weapon"));
+    ASSERT_EQ(ListObjUtils::get_at(players, 0), ListObjUtils::get_at(players, 1)); // still shared
+
+    ASSERT_THROW(serialize(std::make_shared<int>(1)), BadVariableArgException);
+    ASSERT_THROW(deserialize("not game data"), BadVariableArgException);
+    ASSERT_THROW(deserialize(data.substr(0, data.size() - 1)), BadVariableArgException);
+
+    // a deck without a table only decodes when it's empty
+    ASSERT_EQ(0, VariableUtils::size(deserialize(serialize(deckObj()))));
+    Encoder tableless;
+    tableless.writeUInt(varType(deckObj()).index());
+    tableless.writeUInt(0); // no table
+    tableless.writeString(std::string(1, '\0'));
+    ASSERT_THROW(deserialize(tableless.data()), BadVariableArgException);
+
+    // lists nested deeper than maxDepth are rejected instead of running out the stack
+    auto nested = [](size_t depth)
+    {
+        Encoder encoder;
+        for(size_t i = 0; i < depth; i++)
+        {
+            encoder.writeUInt(varType(listObj()).index());
+            encoder.writeUInt(1); // one element
+            encoder.writeUInt(1); // a new Variable
+        }
+        encoder.write(1);
+        return encoder.release();
+    };
+    ASSERT_NO_THROW(deserialize(nested(Decoder::maxDepth - 1)));
+    ASSERT_THROW(deserialize(nested(Decoder::maxDepth)), BadVariableArgException);
+    ASSERT_THROW(deserialize(nested(100000)), BadVariableArgException);
+}
+
+TEST(VariablesTest, sortTest)
+{
+    // init: big enough to be sorted in parallel chunks
+    const int size = 100000;
+    intList ints;
+    listObj pairs;
+    for(int i = 0; i < size; i++)
+    {
+        ints.push_back((i * 7919) % size);
+        varMapType pair;
+        pair[Symbol("key")] = makeVarPtr(i % 10);
+        pair[Symbol("order")] = makeVarPtr(i);
+        pairs.push_back(makeVarPtr(pair));
+    }
+    varType intVar = ints;
+    varType pairVar = pairs;
+
+    ListObjUtils::sort(intVar);
+    ListObjUtils::sort(pairVar, {Symbol("key")});
+
+    // asserts
+    const intList &sortedInts = std::get<intList>(intVar);
+    ASSERT_TRUE(std::is_sorted(sortedInts.begin(), sortedInts.end()));
+    ASSERT_EQ(size, VariableUtils::size(pairVar));
+    int prevKey = -1, prevOrder = -1;
+    for(int i = 0; i < size; i++)
+    {
+        varType &pair = ListObjUtils::get_at(pairVar, i)->getRef();
+        int key = std::get<int>(VariableUtils::getVarWithKey(pair, Symbol("key"))->getRef());
+        int order = std::get<int>(VariableUtils::getVarWithKey(pair, Symbol("order"))->getRef());
+        ASSERT_TRUE(key > prevKey || (key == prevKey && order > prevOrder)); // stable
+        prevKey = key;
+        prevOrder = order;
+    }
+    ASSERT_THROW(ListObjUtils::sort(intVar, {Symbol("key")}), BadVariableArgException);
+}
+
+TEST(VariablesTest, dealTest)
+{
+    // init
+    varType deck = makeVar(1, 2, 3, 4, 5, 6).get();
+    varType hand = listObj();
+    varType typedDeck = intList{1, 2, 3, 4, 5, 6};
+    varType typedHand = intList();
+    std::shared_ptr<Variable> first = ListObjUtils::get_at(deck, 0);
+
+    ListObjUtils::deal(deck, hand, 2);
+    ListObjUtils::deal(typedDeck, typedHand, 2);
+    varType snapshot = typedDeck; // shares storage, dropping from the front must not change it
+    ListObjUtils::remove(typedDeck, 1);
+
+    // asserts
+    ASSERT_EQ(4, VariableUtils::size(deck));
+    ASSERT_EQ(first, ListObjUtils::get_at(hand, 0)); // moved, not copied
+    ASSERT_TRUE(ListObjUtils::get_at(deck, 0)->isEqual(3));
+    ASSERT_TRUE(VariableUtils::compare(typedHand, intList{1, 2}));
+    ASSERT_TRUE(VariableUtils::compare(typedDeck, intList{4, 5, 6}));
+    ASSERT_TRUE(VariableUtils::compare(snapshot, intList{3, 4, 5, 6}));
+
+    // more than there is takes what's left
+    ListObjUtils::deal(typedDeck, hand, 10); // different kinds of list
+    ASSERT_EQ(0, VariableUtils::size(typedDeck));
+    ASSERT_EQ(5, VariableUtils::size(hand));
+    ASSERT_TRUE(ListObjUtils::get_at(hand, 4)->isEqual(6));
+    ListObjUtils::push_back(typedDeck, 7);
+    ASSERT_TRUE(ListObjUtils::get_at(typedDeck, 0)->isEqual(7));
+
+    ListObjUtils::remove(hand, 100);
+    ASSERT_EQ(0, VariableUtils::size(hand));
+    ASSERT_THROW(ListObjUtils::remove(hand, "1"), BadVariableArgException);
+}
+
+TEST(VariablesTest, deckTest)
+{
+    // init
+    varType deck = deckObj(CardTable::standard());
+    varType hand = deckObj();
+    varType pile = listObj();
+    Random rng(7);
+
+    ListObjUtils::shuffle(deck, rng);
+    ListObjUtils::deal(deck, hand, 5);
+    ListObjUtils::deal(deck, pile, 2);
+    ListObjUtils::remove(deck, 1);
+    std::string firstCard = VariableUtils::getWithKey(hand, 0);
+
+    // asserts
+    ASSERT_EQ(Type::DECK, VariableUtils::getType(deck));
+    ASSERT_EQ(44, VariableUtils::size(deck));
+    ASSERT_EQ(Type::DECK, VariableUtils::getType(hand));
+    ASSERT_EQ(5, VariableUtils::size(hand));
+    ASSERT_TRUE(ListObjUtils::contains(hand, firstCard));
+    ASSERT_FALSE(ListObjUtils::contains(deck, firstCard));
+    ASSERT_FALSE(ListObjUtils::contains(deck, "Joker"));
+
+    // dealt to a listObj, cards are maps of their attributes
+    ASSERT_EQ(2, VariableUtils::size(pile));
+    varType &card = ListObjUtils::get_at(pile, 0)->getRef();
+    ASSERT_EQ(Type::VAR_MAP, VariableUtils::getType(card));
+    ASSERT_EQ(3, VariableUtils::size(card));
+
+    ListObjUtils::sort(hand, {Symbol("rank")});
+    int rank = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        int next = std::get<int>(VariableUtils::getVarWithKey(ListObjUtils::get_at(hand, i)->getRef(), Symbol("rank"))->getRef());
+        ASSERT_LE(rank, next);
+        rank = next;
+    }
+
+    // copies share cards until changed, and round trip through serialize
+    varType copy = hand;
+    ASSERT_TRUE(VariableUtils::compare(copy, hand));
+    ASSERT_EQ(VariableUtils::hash(copy), VariableUtils::hash(hand));
+    varType decoded = deserialize(serialize(hand));
+    ASSERT_TRUE(VariableUtils::compare(decoded, hand)); // equal tables
+    ASSERT_EQ(VariableUtils::hash(decoded), VariableUtils::hash(hand));
+
+    // a card count past the limit is an error, not a shorter table that puts every later field off
+    Encoder badDeck;
+    badDeck.writeUInt(varType(deckObj()).index());
+    badDeck.writeUInt(1); // new table
+    badDeck.writeUInt(257);
+    for(int i = 0; i < 257; i++)
+    {
+        badDeck.writeInt(0);
+        badDeck.writeString("suit");
+        badDeck.writeString("name");
+    }
+    badDeck.writeString("");
+    ASSERT_THROW(deserialize(badDeck.data()), BadVariableArgException);
+    ListObjUtils::remove(copy, 1);
+    ASSERT_EQ(5, VariableUtils::size(hand));
+
+    // indexing a deck for a Variable makes it a listObj so writes to the card stick
+    VariableUtils::getVarWithKey(VariableUtils::getVarWithKey(copy, 0)->getRef(), Symbol("rank"))->set(99);
+    ASSERT_EQ(Type::LIST, VariableUtils::getType(copy));
+    ASSERT_TRUE(VariableUtils::borrowVarWithKey(VariableUtils::borrowVarWithKey(copy, 0)->getRef(), Symbol("rank"))->isEqual(99));
+    ASSERT_EQ(Type::DECK, VariableUtils::getType(hand)); // the copy it shared cards with is untouched
+
+    // anything that isn't a card turns it into a listObj
+    ListObjUtils::push_back(hand, 1);
+    ASSERT_EQ(Type::LIST, VariableUtils::getType(hand));
+    ASSERT_EQ(6, VariableUtils::size(hand));
+}
+
+// check seeded shuffles are reproducible
+TEST(VariablesTest, randomTest)
+{
+    // init
+    Random rng1(42);
+    Random rng2(42);
+    varType list1 = makeVar(0, 1, 2, 3, 4, 5, 6, 7, 8, 9).get();
+    varType list2 = makeVar(0, 1, 2, 3, 4, 5, 6, 7, 8, 9).get();
+
+    // asserts
+    ListObjUtils::shuffle(list1, rng1);
+    ListObjUtils::shuffle(list2, rng2);
+    std::stringstream order1, order2;
+    VariableUtils::printValue(list1, "", order1);
+    VariableUtils::printValue(list2, "", order2);
+    ASSERT_EQ(order1.str(), order2.str());
+    ASSERT_EQ(42, rng1.getSeed());
+
+    // state round trips, including mid sequence
+    std::stringstream saved;
+    saved << rng1;
+    Random restored;
+    saved >> restored;
+    ASSERT_EQ(rng1, restored);
+    ASSERT_EQ(rng1(), restored());
+    ASSERT_NE(Random(1)(), Random(2)());
+}
+// check copies share storage until written to
+TEST(VariablesTest, copyOnWriteTest)
+{
+    // init
+    std::shared_ptr<Variable> list = makeVarPtr(1, 2, 3);
+    varType snapshot = list->get();
+    const listObj &original = std::get<listObj>(list->getRef());
+    const listObj &copy = std::get<listObj>(snapshot);
+
+    // asserts
+    ASSERT_TRUE(copy.isShared());
+    ASSERT_EQ(original.begin(), copy.begin()); // reads don't copy
+    ASSERT_TRUE(VariableUtils::compare(snapshot, list->getRef()));
+
+    ListObjUtils::push_back(list->getRef(), 4);
+    ASSERT_FALSE(copy.isShared());
+    ASSERT_EQ(3, copy.size());
+    ASSERT_EQ(4, original.size());
+
+    // elements are still shared like before: copying a list doesn't copy its Variables
+    ListObjUtils::get_at(list->getRef(), 0)->set(10);
+    ASSERT_TRUE(copy.at(0)->isEqual(10));
+
+    varMapType m;
+    m[Symbol("name")] = makeVarPtr("player1");
+    varMapType mapCopy = m;
+    ASSERT_TRUE(mapCopy.isShared());
+    mapCopy[Symbol("name")] = makeVarPtr("player2");
+    ASSERT_TRUE(m.at(Symbol("name"))->isEqual("player1"));
+    ASSERT_TRUE(mapCopy.at(Symbol("name"))->isEqual("player2"));
+}
 // check custom objs
 TEST(VariablesTest, ptrTest)
 {
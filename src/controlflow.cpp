@@ -3,14 +3,15 @@
 using namespace var;
 
 varType
-getElements(listObj& list, Variable& key)
+getElements(const listObj& list, Variable& key)
 {
-    varType elements = listObj();
+    // values are all strings so store them contiguously
+    stringList elements;
+    elements.reserve(list.size());
 
     for(const auto& map : list)
     {
-        std::string candidate = VariableUtils::getWithKey(map->getRef(),key.get());
-        ListObjUtils::push_back(elements,candidate);
+        elements.emplace_back(VariableUtils::viewWithKey(map->getRef(),key.getRef()));
     }
 
     return elements;
@@ -24,7 +25,7 @@ whose certain key satisfies a condition
 */
 
 var::varType
-collect(listObj& list, Variable& key, Variable& rhs)
+collect(const listObj& list, Variable& key, Variable& rhs)
 {
     std::string* rhsStr;
     rhsStr = std::get_if<std::string>(&(rhs.getRef()));
@@ -36,24 +37,24 @@ collect(listObj& list, Variable& key, Variable& rhs)
             // this conditional would only work for rockpaper as == is hardcoded
             // there is the possibility that other games would use other comparators
             
-            if(VariableUtils::getWithKey(map->getRef(),key.get()) == std::get<std::string>(rhs.get()))
+            if(VariableUtils::viewWithKey(map->getRef(),key.getRef()) == std::get<std::string>(rhs.getRef()))
             {
-                ListObjUtils::push_back(collected, map);
+                std::get<listObj>(collected).push_back(map);
             }
         }    
     return collected;
 }
 
 bool
-contains(listObj& list, Variable& value)
+contains(const listObj& list, Variable& value)
 {
+    return ListObjUtils::contains(list, value.getRef()); // big lists look the value up in their index
+}
 
-    for(const auto& item : list)
-    {
-        if(item->getRef() == value.get())
-            return true;
-    }
-    return false;
+bool
+contains(const varType& list, Variable& value)
+{
+    return ListObjUtils::contains(list, value.getRef()); // typed lists scan their values directly
 }
 
 std::pair<int,int> upFrom(int upFrom, int to)
@@ -1,4 +1,5 @@
 #include "include/gameinstance.h"
+#include "Serializer.hpp"
 
 
 // =======================================GameInstance=============================================
@@ -20,6 +21,7 @@ void GameInstance::addPlayerToGame(int playerId, std::string_view username)
 {
     if(currPlayerCount >= numMaxPlayers)
     { debugPrint("Failed to add player: maximum players reached.");  return; }
+    MemoryResourceGuard guard(memory.get());
 
     // init list if needed
     auto playerList = envMgr->getVariable("player");
@@ -32,16 +34,21 @@ void GameInstance::addPlayerToGame(int playerId, std::string_view username)
 
     // init new player
     varMapType newPlayer;
-    newPlayer["id"] = makeVarPtr(playerId);
-    newPlayer["name"] = makeVarPtr(std::string(username));
+    newPlayer[Symbol("id")] = makeVarPtr(playerId);
+    newPlayer[Symbol("name")] = makeVarPtr(std::string(username));
 
     std::for_each(playerVars.begin(), playerVars.end(),
     [&](const auto &pair)
     {
-        newPlayer[pair.first] = std::make_shared<Variable>(pair.second);
+        newPlayer[Symbol(pair.first)] = allocateVar({}, pair.second);
     });
 
-    ListObjUtils::push_back(playerList->getRef(), varType{newPlayer});
+    ListObjUtils::push_back(*playerList, varType{newPlayer});
+}
+
+void GameInstance::setPlayerVariables(std::map<std::string, varType> vars)
+{
+    playerVars = std::move(vars);
 }
 
 void GameInstance::setConverter(SCConverter &aConverter)
@@ -54,6 +61,66 @@ std::shared_ptr<taskFactory::RunnableTask> GameInstance::convertTask(const std::
     return nullptr;
 }
 
+void GameInstance::setRules(std::shared_ptr<const env_mgr::RuleProgram> rules)
+{
+    executor = rules? std::make_unique<env_mgr::RuleExecutor>(std::move(rules), *envMgr) : nullptr;
+}
+
+const std::shared_ptr<RuleNode>& GameInstance::nextTaskRule()
+{
+    static const std::shared_ptr<RuleNode> none;
+    if(!executor)
+    { return none; }
+    MemoryResourceGuard guard(memory.get());
+    return executor->next();
+}
+
+void GameInstance::timersFired(const std::vector<int> &timerIds)
+{
+    MemoryResourceGuard guard(memory.get());
+    if(auto next = envMgr->fireTimers(timerIds))
+    {
+        nextRule = next;
+        if(executor) { executor->jumpTo(next.get()); }
+    }
+}
+
+std::string GameInstance::snapshot() const
+{
+    if(!executor)
+    { throw BadVariableArgException("Game has no rules to snapshot"); }
+    const auto &program = executor->getProgram();
+    std::optional<size_t> next = nextRule? program.pcOf(nextRule.get()) : std::nullopt;
+
+    var::Encoder encoder;
+    encoder.writeUInt(executor->getPc());
+    encoder.writeUInt(next? *next + 1 : 0);
+    for(uint64_t word : rng->getState()) { encoder.writeUInt(word); }
+    encoder.writeString(envMgr->snapshot(program.getRules()));
+    return encoder.release();
+}
+
+void GameInstance::restore(std::string_view data)
+{
+    if(!executor)
+    { throw BadVariableArgException("Game has no rules to restore"); }
+    const auto &program = executor->getProgram();
+
+    var::Decoder decoder(data);
+    size_t pc = decoder.readUInt();
+    size_t next = decoder.readUInt();
+    var::Random::stateType state;
+    for(auto &word : state) { word = decoder.readUInt(); }
+    std::string scopes = decoder.readString();
+    if(pc > program.size() || next > program.size() || !decoder.atEnd())
+    { throw BadVariableArgException("Snapshot doesn't belong to this game's rules"); }
+
+    envMgr->restore(scopes, program.getRules()); // checks the rest, and throws before changing anything
+    executor->resume(pc);
+    nextRule = next? program.code()[next - 1].node : nullptr;
+    rng->setState(state);
+}
+
 
 // =======================================PlayerHandler=============================================
 GameInstance::Msg::Msg(std::string_view ids, const msgType &msg):
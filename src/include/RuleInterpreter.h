@@ -9,13 +9,16 @@
 #include <memory>
 #include <algorithm>
 #include <ranges>
+#include <cctype>
 
 #include <cpp-tree-sitter.h>
 
 #include "Message.h"
 #include "Task.h"
+#include "Symbol.hpp"
 
 class RuleNode;
+namespace env_mgr { class Expression; }
 
 // free function to help with parsing
 std::string_view getNodeValue(const std::string_view source, const ts::Node& node);
@@ -61,21 +64,57 @@ private:
 
 class RuleNode{
 public:
-    RuleNode(std::vector<std::vector<std::string>> list, NodeType type) : list(list), type(type) {}
+    RuleNode(std::vector<std::vector<std::string>> list, NodeType type) : list(list), type(type) {
+		// intern names once at parse time so lookups by name compare ints. literals and operators are never looked
+		// up, they get an empty Symbol instead of a place in the (never freed) symbol table
+		for(const auto &expressionList : this->list){
+			auto &row = symbols.emplace_back();
+			for(const auto &token : expressionList){
+				row.push_back(isName(token)? var::Symbol(token) : var::Symbol());
+			}
+		}
+	}
 	virtual bool isControlFlow() const = 0;
 	std::shared_ptr<RuleNode> getNextNode() {return nextNode;}
 	std::weak_ptr<RuleNode> getParentNode() {return parentNode;}
     void setNextNode(std::shared_ptr<RuleNode> next) {nextNode = next;}
     void setParentNode(std::weak_ptr<RuleNode> parent) {parentNode = parent;}
 
-    std::vector<std::vector<std::string>> getData() {return list;};
+    const std::vector<std::vector<std::string>>& getData() const {return list;}
+	// same shape as getData()
+	const std::vector<std::vector<var::Symbol>>& getSymbols() const {return symbols;}
+	// filled in by EnvironmentManager::resolve(), same shape as getSymbols(). empty if the tree wasn't resolved
+	const std::vector<std::vector<var::SlotRef>>& getSlots() const {return slots;}
+	// names that get a slot in the scope this node opens (the loop variable of a for/parallel)
+	const std::vector<var::Symbol>& getScopeNames() const {return scopeNames;}
+	void setSlots(std::vector<std::vector<var::SlotRef>> someSlots) {slots = std::move(someSlots);}
+	void setScopeNames(std::vector<var::Symbol> names) {scopeNames = std::move(names);}
+	// each row of getData() compiled by EnvironmentManager::resolve(), nullptr for rows that aren't one expression
+	const std::vector<std::shared_ptr<const env_mgr::Expression>>& getExpressions() const {return expressions;}
+	void setExpressions(std::vector<std::shared_ptr<const env_mgr::Expression>> someExpressions) {expressions = std::move(someExpressions);}
+	// the key of each child in getBody() compiled by EnvironmentManager::resolve() (match guards), nullptr where it
+	// isn't one expression. empty if the tree wasn't resolved
+	const std::vector<std::shared_ptr<const env_mgr::Expression>>& getGuards() const {return guards;}
+	void setGuards(std::vector<std::shared_ptr<const env_mgr::Expression>> someGuards) {guards = std::move(someGuards);}
 	NodeType getType() const {return type;}
-	virtual std::vector<ChildNode> getBody() const = 0;
-    virtual ChildNode getChildWithKey(std::vector<std::string> key) const = 0;
+	virtual const std::vector<ChildNode>& getBody() const = 0;
+    virtual ChildNode getChildWithKey(const std::vector<std::string> &key) const = 0;
 protected:
+	// identifiers and paths (player.name), not quoted strings, numbers or operators
+	static bool isName(std::string_view token) {
+		if(token.empty() || !(std::isalpha((unsigned char) token[0]) || token[0] == '_'))
+		{ return false; }
+		return std::ranges::all_of(token, [](unsigned char c) { return std::isalnum(c) || c == '_' || c == '.'; });
+	}
+
 	std::shared_ptr<RuleNode> nextNode = nullptr;
 	std::weak_ptr<RuleNode> parentNode;
 	std::vector<std::vector<std::string>> list;
+	std::vector<std::vector<var::Symbol>> symbols;
+	std::vector<std::vector<var::SlotRef>> slots;
+	std::vector<var::Symbol> scopeNames;
+	std::vector<std::shared_ptr<const env_mgr::Expression>> expressions;
+	std::vector<std::shared_ptr<const env_mgr::Expression>> guards;
     NodeType type;
 };
 
@@ -83,8 +122,8 @@ class TaskRuleNode : public RuleNode{
 public:
     TaskRuleNode(std::vector<std::vector<std::string>> list, NodeType type) : RuleNode(list, type) {}
 	bool isControlFlow() const {return false;}
-	std::vector<ChildNode> getBody() const {return {};};
-    ChildNode getChildWithKey(std::vector<std::string> key) const override { return ChildNode(); }
+	const std::vector<ChildNode>& getBody() const {static const std::vector<ChildNode> none; return none;};
+    ChildNode getChildWithKey(const std::vector<std::string> &key) const override { return ChildNode(); }
 };
 
 // if condition is false, go to nextNode
@@ -96,14 +135,12 @@ public:
 		ChildNode node = {guard, childNode};
 		children.push_back(node);
 	}
-	std::vector<ChildNode> getBody() const {return children;}
-    ChildNode getChildWithKey(std::vector<std::string> key) const override
+	const std::vector<ChildNode>& getBody() const {return children;}
+    // by the guard's tokens, for tools and tests. running rules picks match arms through RuleProgram's tables
+    ChildNode getChildWithKey(const std::vector<std::string> &key) const override
     {
-        namespace views = std::ranges::views;
-        auto view = children
-                    | views::filter([&key](const auto &child) { return child.key == key; })
-                    | views::take(1);
-        return *view.begin();
+        auto it = std::ranges::find(children, key, &ChildNode::key);
+        return it == children.end()? ChildNode() : *it;
     }
 private:
 	//using struct due to ordering of map not being chronological
@@ -8,13 +8,16 @@ enum LogicalOperator
 };
 
 var::varType 
-getElements(var::listObj& list, var::Variable& key);
+getElements(const var::listObj& list, var::Variable& key);
 
 var::varType
-collect(var::listObj& list, var::Variable& key, var::Variable& rhs);
+collect(const var::listObj& list, var::Variable& key, var::Variable& rhs);
 
 bool
-contains(var::listObj& list, var::Variable& value);
+contains(const var::listObj& list, var::Variable& value);
+
+bool
+contains(const var::varType& list, var::Variable& value);
 
 std::pair<int,int> 
 upFrom(int upFrom, int to);
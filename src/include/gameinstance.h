@@ -4,8 +4,10 @@
 #include <string_view>
 #include <unordered_map>
 #include <memory>
+#include <memory_resource>
 #include "SocialGamingTaskFactory.hpp"
 #include "EnvironmentMgr.hpp"
+#include "RuleProgram.hpp"
 
 
 class SCConverter;
@@ -20,6 +22,8 @@ class GameInstance
         int getGameInstanceId();
 
         void addPlayerToGame(int playerId, std::string_view username);
+        // variables every player added from now on starts with (a copy of each)
+        void setPlayerVariables(std::map<std::string, varType> vars);
         void removePlayerFromGame(const int& playerId); // [TODO]
 
         std::shared_ptr<taskFactory::RunnableTask> getTask();
@@ -27,6 +31,22 @@ class GameInstance
         void setConverter(SCConverter &aConverter);
         std::shared_ptr<taskFactory::RunnableTask> convertTask(const std::shared_ptr<RuleNode> &node);
 
+        // rules lowered by RuleProgram::lower(), can be shared with other games. runs them from the start
+        void setRules(std::shared_ptr<const env_mgr::RuleProgram> rules);
+        // runs the rules' control flow up to the next task and returns its rule node, nullptr when done (or no rules)
+        const std::shared_ptr<RuleNode>& nextTaskRule();
+
+        // called by GameInstanceManager with the ids of this game's timers that went off
+        void timersFired(const std::vector<int> &timerIds);
+        // where to continue after a STOP timer cut the current rules short, nullptr if none did
+        std::shared_ptr<RuleNode> getNextRule() const { return nextRule; }
+
+        // the game's position in its rules (pc, scopes, timers, rng), to pick it up again later or in another process.
+        // restore() needs the same rules set (setRules) and replaces the current state, bad data leaves it as it was.
+        // both throw BadVariableArgException without rules
+        std::string snapshot() const;
+        void restore(std::string_view data);
+
         using msgType = std::map<std::string, std::string>;
         struct Msg
         {
@@ -35,8 +55,14 @@ class GameInstance
             msgType message;
             bool operator==(const Msg& other) const = default;
         };
-        std::shared_ptr<env_mgr::EnvironmentManager> envMgr = std::make_shared<env_mgr::EnvironmentManager>();
+        // arena for all game state of this instance. Variables are still destroyed one by one with envMgr, the pool
+        // hands its memory back once the game and every Variable handle taken from it are gone.
+        // needs to be declared before envMgr
+        std::shared_ptr<std::pmr::memory_resource> memory = var::GameArena::create();
+        std::shared_ptr<env_mgr::EnvironmentManager> envMgr = std::make_shared<env_mgr::EnvironmentManager>(memory);
         std::shared_ptr<PlayerHandler> playerHandler = std::make_shared<PlayerHandler>();
+        // every random rule draws from this, so a session can be replayed by seeding it with the same value
+        std::shared_ptr<var::Random> rng = std::make_shared<var::Random>();
 
     private:
         std::string gameInstanceName;
@@ -46,8 +72,10 @@ class GameInstance
 
         std::shared_ptr<taskFactory::RunnableTask> currTask;
         std::shared_ptr<SCConverter> converter;
+        std::shared_ptr<RuleNode> nextRule;
+        std::unique_ptr<env_mgr::RuleExecutor> executor; // this game's position in its rules
 
-        std::map<std::string, varType> playerVars; // [TODO] init from tree
+        std::map<std::string, varType> playerVars; // set by CompiledGame::start()
 };
 
 class PlayerHandler
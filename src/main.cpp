@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <memory>
@@ -10,43 +11,31 @@
 #include <vector>
 
 #include "RuleInterpreter.h"
-#include <cpp-tree-sitter.h>
-
-extern "C" {
-  TSLanguage* tree_sitter_socialgaming();
-}
+#include "CompiledGame.h"
+#include "GameLoader.h"
 
 int main(int argc, char *argv[]) {
 
-	ts::Language language = tree_sitter_socialgaming();
-	ts::Parser parser{ language };
-
 	const std::string defaultGameDirectory = "games/";
-
-	std::vector<RuleInterpreter> ruleInterpreters;
-	for (const auto& entry :  std::filesystem::directory_iterator(defaultGameDirectory)) {
-
-		std::ifstream gameFile(entry.path());
-		std::stringstream buffer;
-		buffer << gameFile.rdbuf();
-
-		RuleInterpreter ruleInterpreter { std::filesystem::path(entry).stem().string(), buffer.str() };
-		ruleInterpreters.push_back((ruleInterpreter));
+	// compiled games are kept here, so a restart skips parsing games that haven't changed
+	GameRegistry registry { "cache/" };
+
+	// every game file is mapped and compiled in parallel
+	std::vector<GameLoader::Result> games = GameLoader { registry }.loadDirectory(defaultGameDirectory);
+	for (const auto& result : games) {
+		std::cout << result.name << ": " << result.time.count() << "us";
+		if (!result.game) {
+			std::cout << " failed: " << result.error;
+		}
+		std::cout << std::endl;
 	}
 
-	std::string_view source = ruleInterpreters[0].getSource();
-
-	ts::Tree tree = parser.parseString(source);
-	ts::Node root = tree.getRootNode();
-
-	ts::Node configuration = root.getChildByFieldName("configuration");
-	ts::Node rules = root.getChildByFieldName("rules");
-
-	std::string_view gameName = getChildNodeValue(source, "name", configuration);
-	std::cout << "game name: " << gameName << std::endl;
+	auto loaded = std::find_if(games.begin(), games.end(), [](const auto& result) { return result.game != nullptr; });
+	if (loaded == games.end()) {
+		return 1;
+	}
 
-	std::shared_ptr<RuleTree> ruleTree = parseRules(rules, source);
+	std::cout << "game name: " << loaded->game->getName() << std::endl;
 
-	
-	printRuleTreeRecursively(ruleTree.get()->getRules().get(), 0);
-}
\ No newline at end of file
+	printRuleTreeRecursively(loaded->game->getRules().get(), 0);
+}
@@ -9,8 +9,8 @@ using namespace var;
 TEST(GetElementsTest,testSingle)
 {
     mapType map1;
-    map1["name"] = std::make_shared<std::string>("John");
-    map1["two"] = std::make_shared<std::string>("2");
+    map1[Symbol("name")] = std::make_shared<std::string>("John");
+    map1[Symbol("two")] = std::make_shared<std::string>("2");
 
     listObj list{makeVarPtr(map1)};
     Variable key = makeVar("name");
@@ -26,20 +26,20 @@ TEST(GetElementsTest,testMultiple)
 {
     Variable key = makeVar("score");
     mapType map1;
-    map1["name"] = std::make_shared<std::string>("John");
-    map1["score"] = std::make_shared<std::string>("0");
+    map1[Symbol("name")] = std::make_shared<std::string>("John");
+    map1[Symbol("score")] = std::make_shared<std::string>("0");
 
     mapType map2;
-    map2["name"] = std::make_shared<std::string>("Paul");
-    map2["score"] = std::make_shared<std::string>("2");
+    map2[Symbol("name")] = std::make_shared<std::string>("Paul");
+    map2[Symbol("score")] = std::make_shared<std::string>("2");
 
     mapType map3;
-    map3["name"] = std::make_shared<std::string>("Ringo");
-    map3["score"] = std::make_shared<std::string>("1");
+    map3[Symbol("name")] = std::make_shared<std::string>("Ringo");
+    map3[Symbol("score")] = std::make_shared<std::string>("1");
 
     mapType map4;
-    map4["name"] = std::make_shared<std::string>("George");
-    map4["score"] = std::make_shared<std::string>("0");
+    map4[Symbol("name")] = std::make_shared<std::string>("George");
+    map4[Symbol("score")] = std::make_shared<std::string>("0");
 
     listObj list{makeVarPtr(map1),makeVarPtr(map2),makeVarPtr(map3),makeVarPtr(map4)};
 
@@ -48,6 +48,12 @@ TEST(GetElementsTest,testMultiple)
 
     ASSERT_EQ(4,VariableUtils::size(elements));
     ASSERT_TRUE(ListObjUtils::contains(elements,"2"));
+
+    // all strings so they're stored as a typed list
+    Variable one = makeVar("1");
+    ASSERT_EQ(Type::STRING_LIST, VariableUtils::getType(elements));
+    ASSERT_TRUE(contains(elements,one));
+    ASSERT_TRUE(VariableUtils::compare(elements,makeVar("0","2","1","0").get()));
 }
 
 // empty list can be returned
@@ -57,8 +63,8 @@ TEST(CollectTest, testEmpty)
 {
     Variable key = makeVar("zero");
     mapType map;
-    map["zero"] = std::make_shared<std::string>("0");
-    map["two"] = std::make_shared<std::string>("2");
+    map[Symbol("zero")] = std::make_shared<std::string>("0");
+    map[Symbol("two")] = std::make_shared<std::string>("2");
     listObj list{makeVarPtr(map)};
     Variable rhs = makeVar("1");
     varType collected = collect(list,key,rhs);
@@ -71,7 +77,7 @@ TEST(CollectTest, testSingle)
 {
     Variable key = makeVar("zero");
     mapType map;
-    map["zero"] = std::make_shared<std::string>("0");
+    map[Symbol("zero")] = std::make_shared<std::string>("0");
     listObj list{makeVarPtr(map)};
     Variable rhs = makeVar("0");
 
@@ -86,20 +92,20 @@ TEST(CollectTest, testMultiple)
 {
     Variable key = makeVar("score");
     mapType map1;
-    map1["name"] = std::make_shared<std::string>("John");
-    map1["score"] = std::make_shared<std::string>("0");
+    map1[Symbol("name")] = std::make_shared<std::string>("John");
+    map1[Symbol("score")] = std::make_shared<std::string>("0");
 
     mapType map2;
-    map2["name"] = std::make_shared<std::string>("Paul");
-    map2["score"] = std::make_shared<std::string>("2");
+    map2[Symbol("name")] = std::make_shared<std::string>("Paul");
+    map2[Symbol("score")] = std::make_shared<std::string>("2");
 
     mapType map3;
-    map3["name"] = std::make_shared<std::string>("Ringo");
-    map3["score"] = std::make_shared<std::string>("1");
+    map3[Symbol("name")] = std::make_shared<std::string>("Ringo");
+    map3[Symbol("score")] = std::make_shared<std::string>("1");
 
     mapType map4;
-    map4["name"] = std::make_shared<std::string>("George");
-    map4["score"] = std::make_shared<std::string>("0");
+    map4[Symbol("name")] = std::make_shared<std::string>("George");
+    map4[Symbol("score")] = std::make_shared<std::string>("0");
 
     listObj list{makeVarPtr(map1),makeVarPtr(map2),makeVarPtr(map3),makeVarPtr(map4)};
 
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "gameinstance.h"
+#include "Expression.hpp"
 
 
 TEST(gameinstance, playeraddtest)
@@ -25,4 +26,107 @@ TEST(gameinstance, playeraddtest)
     auto playerId = VariableUtils::getVarWithKey(player->getRef(), key);
 
     ASSERT_EQ(varType{1}, playerId->get());
-}
\ No newline at end of file
+}
+
+// a join changes the player list's version, so results cached from it are computed again
+TEST(gameinstance, playercachetest)
+{
+    auto game = GameInstance("cache", 1);
+    game.addPlayerToGame(1, "player 1");
+    auto count = Expression::compile({"player", "size"});
+    ASSERT_EQ(varType(1), game.envMgr->evaluateCached(count));
+    game.addPlayerToGame(2, "player 2");
+    ASSERT_EQ(varType(2), game.envMgr->evaluateCached(count));
+}
+
+TEST(gameinstance, arenatest)
+{
+    auto game = GameInstance("arena", 1);
+    game.addPlayerToGame(1, "player 1");
+    game.addPlayerToGame(2, "player 2");
+
+    auto players = game.envMgr->getVariable("player");
+    ASSERT_NE(players, nullptr);
+    ASSERT_EQ(2, players->size());
+
+    // player list + player records live in the game's arena
+    ASSERT_EQ(game.memory.get(), std::get<listObj>(players->getRef()).get_allocator().resource());
+    auto player = ListObjUtils::get_at(players->getRef(), 1);
+    ASSERT_EQ(game.memory.get(), std::get<varMapType>(player->getRef()).get_allocator().resource());
+}
+
+TEST(gameinstance, outliveTest)
+{
+    // a handle kept after the game is gone keeps the game's arena alive, it never points into freed memory
+    auto game = std::make_unique<GameInstance>("outlive", 1);
+    {
+        MemoryResourceGuard guard(game->memory.get());
+        game->envMgr->setVariable("x", makeVarPtr(1, 2, 3));
+    }
+    game->addPlayerToGame(1, "player 1");
+    auto x = game->envMgr->getVariable("x");
+    auto players = game->envMgr->getVariable("player");
+    game.reset();
+
+    ASSERT_EQ(3, x->size());
+    ListObjUtils::push_back(x->getRef(), 4); // still allocates from the arena
+    ASSERT_EQ(4, x->size());
+    auto player = ListObjUtils::get_at(players->getRef(), 0);
+    ASSERT_TRUE(VariableUtils::getVarWithKey(player->getRef(), Symbol("name"))->isEqual("player 1"));
+    x.reset();
+    player.reset();
+    players.reset();
+}
+
+// a game restored mid loop carries on where the snapshot was taken, without starting the loop over
+TEST(gameinstance, snapshotTest)
+{
+    // init
+    using rows = std::vector<std::vector<std::string>>;
+    auto loop = std::make_shared<ControlFlowRuleNode>(rows{{"for"}, {"round"}, {"in", "rounds"}}, NodeType::FOR);
+    auto message = std::make_shared<TaskRuleNode>(rows{{"round"}}, NodeType::MESSAGE);
+    auto match = std::make_shared<ControlFlowRuleNode>(rows{{"round"}}, NodeType::MATCH);
+    auto first = std::make_shared<TaskRuleNode>(rows(), NodeType::SHUFFLE);
+    auto second = std::make_shared<TaskRuleNode>(rows(), NodeType::SORT);
+    auto after = std::make_shared<TaskRuleNode>(rows(), NodeType::SCORES);
+    loop->setChildren({"true"}, message);
+    message->setNextNode(match);
+    match->setChildren({"1"}, first);
+    match->setChildren({"2"}, second);
+    loop->setNextNode(after);
+    auto program = env_mgr::RuleProgram::lower(loop);
+
+    GameInstance game("snapshot", 1);
+    {
+        MemoryResourceGuard guard(game.memory.get());
+        game.envMgr->setVariable("rounds", makeVarPtr(1, 2, 3));
+    }
+    game.setRules(program);
+    game.rng->seed(7);
+    ASSERT_EQ(message, game.nextTaskRule());
+    ASSERT_EQ(first, game.nextTaskRule());
+    std::string data = game.snapshot();
+
+    GameInstance restored("snapshot", 2);
+    restored.setRules(program);
+    restored.restore(data);
+
+    // asserts
+    ASSERT_EQ(3, restored.envMgr->depth()); // global, loop, match: no extra loop scope
+    ASSERT_EQ(*game.rng, *restored.rng);
+    ASSERT_EQ(data, restored.snapshot());
+    for(auto expected : {message, second, message, after})
+    {
+        ASSERT_EQ(expected, game.nextTaskRule());
+        ASSERT_EQ(expected, restored.nextTaskRule());
+        if(expected == message) { ASSERT_EQ(game.envMgr->getVariable("round")->get(), restored.envMgr->getVariable("round")->get()); }
+    }
+    ASSERT_EQ(nullptr, restored.nextTaskRule());
+    ASSERT_EQ(1, restored.envMgr->depth());
+
+    GameInstance other("other", 3);
+    ASSERT_THROW(other.restore(data), BadVariableArgException); // no rules
+    other.setRules(env_mgr::RuleProgram::lower(after));
+    ASSERT_THROW(other.restore(data), BadVariableArgException); // different rules
+    ASSERT_EQ(1, other.envMgr->depth());
+}
@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include "gameinstancemanager.h"
+
+using namespace std::chrono_literals;
+
+
+// a game whose timer fires is queued once, even if it was queued already, and taking the next game fires timers
+TEST(gameinstancemanager, timertest)
+{
+    GameInstanceManager manager;
+    manager.createGameInstance("timed", 1);
+    manager.createGameInstance("idle", 2);
+    auto timed = manager.getGameInstanceFromMap(1);
+    auto idle = manager.getGameInstanceFromMap(2);
+    auto node = std::make_shared<TaskRuleNode>(std::vector<std::vector<std::string>>(), NodeType::MESSAGE);
+
+    // already queued when its timer fires
+    timed->envMgr->enterScope(node, env_mgr::Timer(1, nullptr, 1ms, env_mgr::Timer::Type::REGUALR, "done"));
+    manager.putGameInstanceInQueue(timed);
+    manager.putGameInstanceInQueue(timed);
+    std::this_thread::sleep_for(5ms);
+    ASSERT_EQ(1, manager.updateTimers());
+    ASSERT_TRUE(timed->envMgr->getVariable("done")->isEqual(true));
+    ASSERT_EQ(timed, manager.getGameInstanceFromQueue());
+    ASSERT_EQ(nullptr, manager.getGameInstanceFromQueue());
+
+    // not queued: the loop picks it up without calling updateTimers itself
+    idle->envMgr->enterScope(node, env_mgr::Timer(2, nullptr, 1ms, env_mgr::Timer::Type::REGUALR, "woken"));
+    std::this_thread::sleep_for(5ms);
+    ASSERT_EQ(idle, manager.getGameInstanceFromQueue());
+    ASSERT_TRUE(idle->envMgr->getVariable("woken")->isEqual(true));
+    ASSERT_EQ(0, manager.updateTimers());
+    ASSERT_EQ(nullptr, manager.getGameInstanceFromQueue());
+}